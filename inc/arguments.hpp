@@ -0,0 +1,148 @@
+#ifndef ARGUMENTS_HPP
+#define ARGUMENTS_HPP
+
+#pragma once
+
+namespace rez
+{
+
+/**
+ * @brief command line arguments, options are "--name value", "--name=value" or "--name" for flags
+ * @note query the options before the positional arguments
+ */
+class c_arguments
+{
+public:
+	c_arguments(
+		const std::vector< std::string_view >& args
+	) :
+		m_args{ args },
+		m_used( args.size(), false )
+	{
+	}
+	~c_arguments() = default;
+public:
+	auto flag( const std::string_view name ) -> bool
+	{
+		for ( std::size_t i = 0u; i < m_args.size(); ++i )
+		{
+			if ( !m_used[ i ] && is_option( m_args[ i ], name ) )
+			{
+				m_used[ i ] = true;
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	auto option( const std::string_view name ) -> std::optional< std::string_view >
+	{
+		for ( std::size_t i = 0u; i < m_args.size(); ++i )
+		{
+			if ( m_used[ i ] )
+				continue;
+
+			const auto arg = m_args[ i ];
+
+			// --name=value
+			if ( arg.starts_with( "--" ) && arg.substr( 2u ).starts_with( name ) && arg.size() > name.size() + 2u && arg[ name.size() + 2u ] == '=' )
+			{
+				m_used[ i ] = true;
+
+				return arg.substr( name.size() + 3u );
+			}
+
+			// --name value
+			if ( is_option( arg, name ) )
+			{
+				if ( i + 1u >= m_args.size() )
+					REZ_THROW( "Missing value for --{:s}", name );
+
+				m_used[ i ]      = true;
+				m_used[ i + 1u ] = true;
+
+				return m_args[ i + 1u ];
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	template< typename T >
+	auto option( const std::string_view name, const T fallback ) -> T
+	{
+		const auto value = this->option( name );
+
+		if ( !value )
+			return fallback;
+
+		return parse< T >( name, *value );
+	}
+
+	/**
+	 * @brief remaining arguments, unknown options are an error
+	 */
+	auto positional() -> std::vector< std::string_view >
+	{
+		std::vector< std::string_view > values{};
+
+		for ( std::size_t i = 0u; i < m_args.size(); ++i )
+		{
+			if ( m_used[ i ] )
+				continue;
+
+			if ( m_args[ i ].starts_with( "--" ) )
+				REZ_THROW( "Unknown option: {:s}", m_args[ i ] );
+
+			values.emplace_back( m_args[ i ] );
+		}
+
+		return values;
+	}
+
+	/**
+	 * @brief parse a number, accepts the K/M/G suffixes (i.e 64K, 200M)
+	 */
+	template< typename T >
+	static auto parse( const std::string_view name, std::string_view value ) -> T
+	{
+		std::uint64_t scale = 1u;
+
+		if ( !value.empty() )
+		{
+			switch ( std::toupper( static_cast< unsigned char >( value.back() ) ) )
+			{
+			case 'K': scale = 1ull << 10u; break;
+			case 'M': scale = 1ull << 20u; break;
+			case 'G': scale = 1ull << 30u; break;
+			default: break;
+			}
+
+			if ( scale != 1u )
+				value.remove_suffix( 1u );
+		}
+
+		T result{};
+
+		const auto [ptr, ec] = std::from_chars( value.data(), value.data() + value.size(), result );
+
+		if ( ec != std::errc{} || ptr != value.data() + value.size() )
+			REZ_THROW( "Invalid value for --{:s}: {:s}", name, value );
+
+		return static_cast< T >( result * static_cast< T >( scale ) );
+	}
+private:
+	static auto is_option( const std::string_view arg, const std::string_view name ) -> bool
+	{
+		return arg.starts_with( "--" ) && arg.substr( 2u ) == name;
+	}
+private:
+	std::vector< std::string_view > m_args;
+	std::vector< bool >             m_used;
+};
+
+}
+
+#endif
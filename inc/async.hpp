@@ -0,0 +1,102 @@
+#ifndef ASYNC_HPP
+#define ASYNC_HPP
+
+#pragma once
+
+#include "rez_file.hpp"
+#include "task.hpp"
+
+namespace rez
+{
+
+/**
+ * @brief archive shared by the tasks of an async extraction, reads are serialized
+ */
+class c_async_archive
+{
+public:
+	c_async_archive( const std::filesystem::path& path ) :
+		m_rez{ path }
+	{
+	}
+public:
+	auto rez() -> c_rez_file& { return m_rez; }
+
+	void read_at( const std::uint32_t pos, char* data, const std::uint32_t size )
+	{
+		std::scoped_lock lock{ m_mutex };
+
+		m_rez.read_at( pos, data, size );
+	}
+private:
+	c_rez_file m_rez;
+	std::mutex m_mutex;
+};
+
+struct progress_t
+{
+	std::size_t           m_resources{};
+	std::size_t           m_total_resources{};
+	std::uint64_t         m_bytes{};
+	std::uint64_t         m_total_bytes{};
+	std::filesystem::path m_path{}; // resource that just finished (relative to the output)
+};
+
+struct async_options_t
+{
+	c_executor*                                          m_executor{};
+
+	// priority of open/index, and of every resource when m_resource_priority is empty
+	int                                                  m_priority{};
+
+	// i.e hot assets first, gets the path relative to the output
+	std::function< int( const std::filesystem::path& ) > m_resource_priority{};
+
+	std::stop_token                                      m_stop{};
+
+	// called from the executor threads, one call at a time
+	std::function< void( const progress_t& ) >           m_progress{};
+};
+
+struct async_result_t
+{
+	std::size_t   m_resources{};
+	std::uint64_t m_bytes{};
+	std::size_t   m_failed{};
+
+	std::string   m_error{}; // the archive couldn't be opened, indexed or its directories created
+};
+
+/**
+ * @brief open the archive and read its header
+ */
+auto open_async( std::filesystem::path path, async_options_t options ) -> c_task< std::shared_ptr< c_async_archive > >;
+
+/**
+ * @brief read the directory blocks
+ */
+auto load_index_async( std::shared_ptr< c_async_archive > archive, async_options_t options ) -> c_task<>;
+
+/**
+ * @brief extract a single resource to output (the directory must exist), returns the bytes written
+ */
+auto extract_resource_async(
+	std::shared_ptr< c_async_archive > archive,
+	const std::size_t dir,
+	const std::size_t res,
+	std::filesystem::path output,
+	const int priority,
+	async_options_t options
+) -> c_task< std::uint64_t >;
+
+/**
+ * @brief open, index and extract every resource concurrently in priority order
+ *
+ * a resource that fails is logged and counted, an archive that fails is reported in m_error,
+ * c_cancelled is thrown once the stop token is set
+ */
+auto extract_async( std::filesystem::path file_path, std::filesystem::path save_path, async_options_t options ) -> c_task< async_result_t >;
+
+}
+
+#endif
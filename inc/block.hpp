@@ -67,7 +67,8 @@ struct block_iterator_t
 	template< typename T = std::uint32_t >
 	inline auto peek() -> T
 	{
-		return *reinterpret_cast< T* >( this->current() );
+		// entries are packed, the fields are not aligned
+		return load_le< T >( this->current() );
 	}
 	inline auto advance( const std::uint32_t size ) -> void
 	{
@@ -105,15 +106,53 @@ struct block_header_t
 	std::uint32_t m_time{};
 };
 
+/**
+ * @brief offsets inside a directory entry, every field is a little endian dword
+ *
+ * header (type, pos, size, time) followed by
+ * - directory: name\0
+ * - resource:  id, ext[4] (reversed, NUL padded), num_keys, name\0, description\0, keys[num_keys]
+ */
+struct entry_layout_t
+{
+	static constexpr std::uint32_t TYPE     = 0x00u;
+	static constexpr std::uint32_t POS      = 0x04u;
+	static constexpr std::uint32_t SIZE     = 0x08u;
+	static constexpr std::uint32_t TIME     = 0x0Cu;
+
+	static constexpr std::uint32_t DIR_NAME = 0x10u;
+
+	static constexpr std::uint32_t RES_ID   = 0x10u;
+	static constexpr std::uint32_t RES_EXT  = 0x14u;
+	static constexpr std::uint32_t RES_KEYS = 0x18u;
+	static constexpr std::uint32_t RES_NAME = 0x1Cu;
+};
+
+static_assert( sizeof( block_header_t ) == entry_layout_t::DIR_NAME );
+
+/**
+ * @brief decode the header of the entry at data
+ */
+inline auto load_block_header( const char* data ) -> block_header_t
+{
+	return {
+		load_le< std::uint32_t >( data + entry_layout_t::TYPE ),
+		load_le< std::uint32_t >( data + entry_layout_t::POS ),
+		load_le< std::uint32_t >( data + entry_layout_t::SIZE ),
+		load_le< std::uint32_t >( data + entry_layout_t::TIME )
+	};
+}
+
 struct block_resource_t
 {
-	block_header_t m_header{};
+	block_header_t               m_header{};
 
-	std::uint32_t  m_id{};
-	std::string    m_type{};
-	std::uint32_t  m_num_keys{};
-	std::string    m_name{};
-	std::string    m_description{};
+	std::uint32_t                m_id{};
+	std::string                  m_type{};
+	std::uint32_t                m_num_keys{};
+	std::string                  m_name{};
+	std::string                  m_description{};
+	std::vector< std::uint32_t > m_keys{};
 
 	auto read_resource( block_iterator_t& itr ) -> block_resource_t&;
 };
@@ -130,15 +169,73 @@ struct directory_t
 	std::string    m_name{};
 };
 
+class c_mapped_file;
+class c_thread_pool;
+
 struct rez_t
 {
 	std::vector< directory_t > m_directories;
 
+	/**
+	 * @brief recursive read of the directory blocks
+	 * @note resources belong to the directory that owns their block, a block shared by several directories is read for each, a loop throws
+	 */
+	void read(
+		c_reader& reader,
+		const std::uint32_t pos,
+		const std::uint32_t size
+	);
+
+	/**
+	 * @brief parse the directory blocks in parallel tasks and merge them in the same (pre)order as read
+	 * @note gives the same directories and resources, in the same order, as read
+	 */
+	void read_parallel(
+		const c_mapped_file& file,
+		const std::uint32_t pos,
+		const std::uint32_t size,
+		c_thread_pool& pool
+	);
+};
+
+/**
+ * @brief a single directory block loaded on demand, entries are located without building the tree
+ */
+struct directory_block_t
+{
+	struct entry_t
+	{
+		std::uint32_t    m_offset{};
+		std::uint32_t    m_type{};
+		std::string_view m_name{};
+		std::string_view m_ext{}; // reversed as stored in the block
+	};
+
+	std::vector< char >                            m_data{};
+	std::vector< entry_t >                         m_entries{};
+
+	// entries of each type (resource, directory) in block order, and whether they are in name order
+	std::array< std::vector< std::uint32_t >, 2u > m_types{};
+	std::array< bool, 2u >                         m_ordered{};
+
 	void read(
 		c_reader& reader,
 		const std::uint32_t pos,
 		const std::uint32_t size
 	);
+
+	/**
+	 * @param sorted binary search the entries when the block really is in name order, a linear scan otherwise
+	 */
+	auto find(
+		const std::uint32_t type,
+		const std::string_view name,
+		const std::string_view ext,
+		const bool sorted
+	) const -> const entry_t*;
+
+	auto header( const entry_t& entry ) const -> block_header_t;
+	auto resource( const entry_t& entry ) const -> block_resource_t;
 };
 
 enum file_directory_entry_type_
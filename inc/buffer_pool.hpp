@@ -0,0 +1,134 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#pragma once
+
+namespace rez
+{
+
+/**
+ * @brief shared pool of page aligned buffers grouped by size class, bounded by a memory budget
+ */
+class c_buffer_pool
+{
+public:
+	static constexpr std::array< std::size_t, 5u > SIZE_CLASSES =
+	{
+		0x10000u,   // 64K
+		0x40000u,   // 256K
+		0x100000u,  // 1M
+		0x400000u,  // 4M
+		0x1000000u  // 16M
+	};
+
+	/**
+	 * @brief buffer on loan, goes back to the pool when destroyed
+	 */
+	class c_buffer
+	{
+	public:
+		c_buffer() = default;
+		c_buffer( c_buffer_pool* pool, char* data, const std::size_t size ) :
+			m_pool{ pool },
+			m_data{ data },
+			m_size{ size }
+		{
+		}
+		c_buffer( c_buffer&& other ) noexcept :
+			m_pool{ std::exchange( other.m_pool, nullptr ) },
+			m_data{ std::exchange( other.m_data, nullptr ) },
+			m_size{ std::exchange( other.m_size, 0u ) }
+		{
+		}
+		c_buffer& operator=( c_buffer&& other ) noexcept
+		{
+			if ( this != &other )
+			{
+				this->reset();
+
+				m_pool = std::exchange( other.m_pool, nullptr );
+				m_data = std::exchange( other.m_data, nullptr );
+				m_size = std::exchange( other.m_size, 0u );
+			}
+
+			return *this;
+		}
+		~c_buffer()
+		{
+			this->reset();
+		}
+	public:
+		auto data() const -> char* { return m_data; }
+		auto size() const -> std::size_t { return m_size; }
+
+		void reset()
+		{
+			if ( m_pool && m_data )
+				m_pool->release( m_data, m_size );
+
+			m_pool = nullptr;
+			m_data = nullptr;
+			m_size = 0u;
+		}
+	private:
+		c_buffer_pool* m_pool{};
+		char*          m_data{};
+		std::size_t    m_size{};
+	};
+
+	struct stats_t
+	{
+		std::uint64_t m_allocated{};
+		std::uint64_t m_peak{};
+		std::uint64_t m_acquired{};
+		std::uint64_t m_reused{};
+		std::uint64_t m_waits{};
+		bool          m_large_pages{};
+	};
+public:
+	/**
+	 * @param large_pages back the buffers with large pages when the process holds SeLockMemoryPrivilege
+	 */
+	c_buffer_pool( const std::uint64_t budget, const bool large_pages );
+	~c_buffer_pool();
+
+	c_buffer_pool( const c_buffer_pool& ) = delete;
+	c_buffer_pool& operator=( const c_buffer_pool& ) = delete;
+public:
+	/**
+	 * @brief smallest buffer class that holds size (capped to the largest class), waits while the budget is in use
+	 */
+	auto acquire( const std::size_t size ) -> c_buffer;
+
+	auto stats() const -> stats_t;
+private:
+	void release( char* data, const std::size_t size );
+
+	auto allocate( const std::size_t size ) -> char*;
+	void free( char* data, const std::size_t size );
+
+	/**
+	 * @brief free cached buffers of other classes until size fits in the budget
+	 */
+	auto trim( const std::size_t size ) -> bool;
+
+	static auto class_index( const std::size_t size ) -> std::size_t;
+private:
+	mutable std::mutex                                       m_mutex;
+	std::condition_variable                                  m_cv;
+
+	std::array< std::vector< char* >, SIZE_CLASSES.size() > m_free;
+
+	std::uint64_t                                            m_budget;
+	std::size_t                                              m_large_page_size;
+	stats_t                                                  m_stats;
+};
+
+/**
+ * @brief pool shared by every extraction, created on first use from g_memory_budget and g_large_pages
+ */
+auto shared_buffer_pool() -> c_buffer_pool&;
+
+}
+
+#endif
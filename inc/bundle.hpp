@@ -0,0 +1,107 @@
+#ifndef BUNDLE_HPP
+#define BUNDLE_HPP
+
+#pragma once
+
+#include "reader.hpp"
+
+namespace rez
+{
+
+class c_rez_file;
+
+/**
+ * @brief compressed bundle layout
+ *
+ * header | frames | index (frames, entries)
+ *
+ * the resources are concatenated in archive offset order into a single stream that is cut
+ * in frames of m_frame_size bytes (the last one may be smaller), each frame is compressed
+ * on its own so any resource can be read by decompressing only the frames it spans
+ */
+struct bundle_header_t
+{
+	std::array< char, 4u > m_magic{};
+	std::uint32_t          m_version{};
+	std::uint32_t          m_algorithm{};
+	std::uint32_t          m_frame_size{};
+	std::uint64_t          m_stream_size{};
+	std::uint64_t          m_index_pos{};
+	std::uint32_t          m_frame_count{};
+	std::uint32_t          m_entry_count{};
+};
+
+struct bundle_frame_t
+{
+	std::uint64_t m_pos{};
+	std::uint32_t m_size{};
+	std::uint32_t m_flags{};
+};
+
+struct bundle_entry_t
+{
+	std::uint64_t m_offset{}; // stream offset
+	std::uint64_t m_size{};
+	std::uint32_t m_time{};
+	std::uint32_t m_path_size{}; // followed by the path
+};
+
+enum bundle_frame_flags_
+{
+	bundle_frame_flags_none   = 0,
+	bundle_frame_flags_stored = 1 << 0 // not compressed
+};
+
+struct bundle_options_t
+{
+	std::uint32_t m_level{ 5u };
+	std::uint64_t m_memory_budget{ 256ull << 20u };
+	std::uint32_t m_frame_size{ 4u << 20u };
+	std::size_t   m_threads{ std::thread::hardware_concurrency() };
+};
+
+/**
+ * @brief write every resource of the archive into a compressed bundle
+ */
+void write_bundle( c_rez_file& rez, const std::filesystem::path& output, const bundle_options_t& options );
+
+/**
+ * @brief random access to the resources of a bundle
+ */
+class c_bundle_reader
+{
+public:
+	struct entry_t
+	{
+		bundle_entry_t m_entry{};
+		std::string    m_path{};
+	};
+public:
+	c_bundle_reader( const std::filesystem::path& path );
+	~c_bundle_reader();
+public:
+	auto find( const std::string_view path ) const -> const entry_t*;
+	auto read( const entry_t& entry ) -> std::vector< char >;
+
+	auto entries() const -> const std::vector< entry_t >& { return m_entries; }
+private:
+	auto read_frame( const std::size_t index ) -> const std::vector< char >&;
+private:
+	c_reader                                       m_reader;
+
+	bundle_header_t                                m_header{};
+	std::vector< bundle_frame_t >                  m_frames{};
+	std::vector< entry_t >                         m_entries{};
+	std::unordered_map< std::string, std::size_t > m_lookup{};
+
+	DECOMPRESSOR_HANDLE                            m_decompressor{};
+
+	// last decompressed frame
+	std::size_t                                    m_frame_index{ std::numeric_limits< std::size_t >::max() };
+	std::vector< char >                            m_frame{};
+	std::vector< char >                            m_compressed{};
+};
+
+}
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef COMMANDS_HPP
+#define COMMANDS_HPP
+
+#pragma once
+
+namespace rez::cmd
+{
+
+/**
+ * @brief run a command line (i.e "extract a.rez b.rez out"), returns the process exit code
+ */
+auto run( const std::vector< std::string_view >& args ) -> int;
+
+}
+
+#endif
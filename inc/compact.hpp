@@ -0,0 +1,54 @@
+#ifndef COMPACT_HPP
+#define COMPACT_HPP
+
+#pragma once
+
+namespace rez
+{
+
+class c_rez_file;
+
+struct compact_options_t
+{
+	// payload alignment, power of two (1 packs them back to back)
+	std::uint32_t         m_alignment{ 1u };
+
+	// access profile, one resource path per line, those payloads go first in that order
+	std::filesystem::path m_profile{};
+};
+
+struct compact_stats_t
+{
+	std::uint64_t m_old_size{};
+	std::uint64_t m_new_size{};
+
+	// bytes of the old archive nothing referenced (patched out payloads/blocks)
+	std::uint64_t m_dead_bytes{};
+
+	// share of the reads in write order that seek (see fragmentation_score), 0 to 1
+	double        m_fragmentation_before{};
+	double        m_fragmentation_after{};
+
+	std::size_t   m_resources{};
+	std::size_t   m_shared{};   // resources that point at the same payload, written once
+	std::size_t   m_profiled{};
+	std::size_t   m_missing{};  // profile lines matching no resource
+};
+
+/**
+ * @brief rewrite the archive with the directory blocks after the header and every payload contiguous
+ *
+ * payloads follow the directory traversal (or the profile), the header and entries keep their
+ * fields apart from the positions, so the sort flag and the variant are unchanged
+ */
+auto write_compacted( c_rez_file& rez, const std::filesystem::path& output, const compact_options_t& options = {} ) -> compact_stats_t;
+
+/**
+ * @brief share of consecutive reads that go backwards or skip 64K or more
+ * @param extents (pos, size) in read order, empty payloads are ignored
+ */
+auto fragmentation_score( const std::span< const std::pair< std::uint64_t, std::uint64_t > > extents ) -> double;
+
+}
+
+#endif
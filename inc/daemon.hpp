@@ -0,0 +1,47 @@
+#ifndef DAEMON_HPP
+#define DAEMON_HPP
+
+#pragma once
+
+namespace rez
+{
+
+/**
+ * @brief extraction daemon protocol
+ *
+ * one request per line, fields separated by tabs:
+ *
+ *   archives
+ *   list     <archive> [prefix]
+ *   stat     <archive> <resource path>
+ *   read     <archive> <resource path>
+ *   extract  <archive> <output directory> [prefix]
+ *   close    <archive>
+ *   shutdown
+ *
+ * <archive> is the file name of a served archive (i.e "GAME.REZ"), paths are matched case insensitively
+ *
+ * every request is answered with "OK <size>\n" followed by size bytes of payload, or "ERR <message>\n",
+ * a connection may send any number of requests
+ */
+struct daemon_options_t
+{
+	std::filesystem::path                m_socket{};
+	std::vector< std::filesystem::path > m_archives{};
+	std::size_t                          m_threads{ std::thread::hardware_concurrency() };
+};
+
+/**
+ * @brief serve the archives over a unix domain socket until a shutdown request
+ */
+void run_daemon( const daemon_options_t& options );
+
+/**
+ * @brief send a single request to a running daemon
+ * @return false with the error message in payload on "ERR"
+ */
+auto request_daemon( const std::filesystem::path& socket, const std::string_view request, std::string& payload ) -> bool;
+
+}
+
+#endif
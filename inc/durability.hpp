@@ -0,0 +1,108 @@
+#ifndef DURABILITY_HPP
+#define DURABILITY_HPP
+
+#pragma once
+
+namespace rez
+{
+
+enum durability_
+{
+	durability_none    = 0, // renamed into place once written, the cache manager writes it back whenever
+	durability_batched = 1, // flushed in groups (group commit), then renamed, then the directories flushed
+	durability_strict  = 2  // flushed and renamed through to the disk one file at a time
+};
+
+struct durability_t
+{
+	durability_   m_mode{ durability_none };
+
+	// a batch is committed once it holds this many files or bytes
+	std::size_t   m_batch_files{ 1000u };
+	std::uint64_t m_batch_bytes{ 0x10000000u };
+};
+
+/**
+ * @brief durability of the extracted files, see c_commit_queue
+ */
+inline durability_t g_durability = {};
+
+auto parse_durability( const std::string_view value ) -> durability_;
+auto durability_name( const durability_ mode ) -> std::string_view;
+
+struct commit_stats_t
+{
+	std::size_t m_files{};
+	std::size_t m_batches{}; // flushes of a whole batch (one per file when strict)
+	std::size_t m_failed{};  // not committed, a batched one is reported and left out of its batch
+	double      m_flush_seconds{};
+};
+
+/**
+ * @brief puts written ".part" files under their final name
+ *
+ * a file only gets its name, and its done callback (the journal record), once it is as durable
+ * as the mode promises: after a power loss a complete looking file is complete, the rest are
+ * ".part" files a resumed extraction writes again
+ */
+class c_commit_queue
+{
+public:
+	c_commit_queue( const durability_t& durability = g_durability ) :
+		m_durability{ durability }
+	{
+	}
+public:
+	/**
+	 * @brief the batched files that fail to commit are reported and left out, the rest still get committed
+	 */
+	void add( const std::filesystem::path& part, const std::filesystem::path& file, const std::uint64_t bytes, std::function< void() > done = {} );
+
+	/**
+	 * @brief commit the batch if it holds a file of that name, call before writing its ".part" again
+	 */
+	void claim( const std::filesystem::path& file );
+
+	/**
+	 * @brief commit what the last batch holds
+	 */
+	void finish();
+
+	auto stats() const -> const commit_stats_t& { return m_stats; }
+private:
+	struct pending_t
+	{
+		std::filesystem::path   m_part{};
+		std::filesystem::path   m_file{};
+		std::function< void() > m_done{};
+	};
+
+	static auto pending_name( const std::filesystem::path& file ) -> std::string;
+
+	void commit();
+private:
+	durability_t                      m_durability;
+
+	std::vector< pending_t >          m_pending{};
+	std::unordered_set< std::string > m_pending_names{};
+	std::uint64_t                     m_pending_bytes{};
+
+	commit_stats_t                    m_stats{};
+};
+
+struct durability_bench_t
+{
+	durability_ m_mode{};
+	double      m_seconds{};
+	double      m_files_per_second{};
+	double      m_bytes_per_second{};
+};
+
+/**
+ * @brief write the same files with every mode to a directory on the output device
+ */
+auto bench_durability( const std::filesystem::path& directory, const std::size_t files, const std::uint32_t file_size, const durability_t& durability ) -> std::vector< durability_bench_t >;
+
+}
+
+#endif
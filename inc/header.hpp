@@ -0,0 +1,214 @@
+#ifndef HEADER_HPP
+#define HEADER_HPP
+
+#pragma once
+
+namespace rez
+{
+
+/**
+ * @brief rez header
+ */
+struct rez_header_t
+{
+	char          m_cr1;
+	char          m_lf1;
+	std::string   m_file_type;
+	char          m_cr2;
+	char          m_lf2;
+	std::string   m_user_title;
+	char          m_cr3;
+	char          m_lf3;
+	char          m_eof1;
+	char          m_head;
+	std::string   m_encode;
+	char          m_tail;
+	char          m_detect_head;
+	std::string   m_detect_encode;
+	char          m_detect_tail;
+	std::uint32_t m_file_format_version;
+	std::uint32_t m_root_dir_pos;
+	std::uint32_t m_root_dir_size;
+	std::uint32_t m_root_dir_time;
+	std::uint32_t m_next_write_pos;
+	std::uint32_t m_time;
+	std::uint32_t m_largest_key_ary;
+	std::uint32_t m_largest_dir_name_size;
+	std::uint32_t m_largest_rez_name_size;
+	std::uint32_t m_largest_comment_size;
+	char          m_is_sorted;
+};
+
+/**
+ * @brief a header field at a fixed offset, the member type gives the encoding
+ *
+ * char          1 byte, checked against m_accept when not empty
+ * std::uint32_t little endian dword
+ * std::string   m_size bytes, padded with m_pad (trailing padding removed) or NUL terminated when m_pad is NUL
+ */
+struct header_field_t
+{
+	using member_t = std::variant< char rez_header_t::*, std::uint32_t rez_header_t::*, std::string rez_header_t::* >;
+
+	std::string_view m_name{};
+	member_t         m_member{};
+	std::uint32_t    m_offset{};
+	std::uint32_t    m_size{};
+	std::string_view m_accept{};
+	char             m_pad{};
+
+	constexpr auto end() const -> std::uint32_t
+	{
+		switch ( m_member.index() )
+		{
+		case 0u: return m_offset + 1u;
+		case 1u: return m_offset + 4u;
+		default: return m_offset + m_size;
+		}
+	}
+};
+
+/**
+ * @brief a header variant, selected by eof1 and the version dword at m_version_pos
+ */
+struct header_layout_t
+{
+	std::string_view                  m_name{};
+	char                              m_eof{};
+	std::uint32_t                     m_version{};
+	std::uint32_t                     m_version_pos{};
+	std::span< const header_field_t > m_fields{};
+
+	// checks across fields, optional
+	void ( *m_validate )( const rez_header_t& header ){};
+
+	constexpr auto size() const -> std::uint32_t
+	{
+		std::uint32_t size = 0u;
+
+		for ( const auto& field : m_fields )
+			size = std::max( size, field.end() );
+
+		return size;
+	}
+
+	/**
+	 * @brief field of a member, nullptr when the variant doesn't store it
+	 */
+	template< typename T >
+	constexpr auto field( T rez_header_t::* member ) const -> const header_field_t*
+	{
+		for ( const auto& field : m_fields )
+		{
+			if ( const auto value = std::get_if< T rez_header_t::* >( &field.m_member ); value && *value == member )
+				return &field;
+		}
+
+		return nullptr;
+	}
+};
+
+//
+// text fields shared by every variant
+//
+inline constexpr std::array HEADER_PREFIX =
+{
+	header_field_t{ "cr1",        &rez_header_t::m_cr1,        0x00u, 0u,  "\r&" },
+	header_field_t{ "lf1",        &rez_header_t::m_lf1,        0x01u, 0u,  "\n#" },
+	header_field_t{ "file_type",  &rez_header_t::m_file_type,  0x02u, 60u, {}, ' ' },
+	header_field_t{ "cr2",        &rez_header_t::m_cr2,        0x3Eu, 0u,  "\r!" },
+	header_field_t{ "lf2",        &rez_header_t::m_lf2,        0x3Fu, 0u,  "\n\"" },
+	header_field_t{ "user_title", &rez_header_t::m_user_title, 0x40u, 60u, {}, ' ' },
+	header_field_t{ "cr3",        &rez_header_t::m_cr3,        0x7Cu, 0u,  "\r%" },
+	header_field_t{ "lf3",        &rez_header_t::m_lf3,        0x7Du, 0u,  "\n'" },
+	header_field_t{ "eof1",       &rez_header_t::m_eof1,       0x7Eu, 0u,  "\x1A*" }
+};
+
+//
+// version and directory fields, only their position changes between variants
+//
+template< std::uint32_t POS >
+inline constexpr std::array HEADER_FIELDS =
+{
+	header_field_t{ "file_format_version",   &rez_header_t::m_file_format_version,   POS },
+	header_field_t{ "root_dir_pos",          &rez_header_t::m_root_dir_pos,          POS + 0x04u },
+	header_field_t{ "root_dir_size",         &rez_header_t::m_root_dir_size,         POS + 0x08u },
+	header_field_t{ "root_dir_time",         &rez_header_t::m_root_dir_time,         POS + 0x0Cu },
+	header_field_t{ "next_write_pos",        &rez_header_t::m_next_write_pos,        POS + 0x10u },
+	header_field_t{ "time",                  &rez_header_t::m_time,                  POS + 0x14u },
+	header_field_t{ "largest_key_ary",       &rez_header_t::m_largest_key_ary,       POS + 0x18u },
+	header_field_t{ "largest_dir_name_size", &rez_header_t::m_largest_dir_name_size, POS + 0x1Cu },
+	header_field_t{ "largest_rez_name_size", &rez_header_t::m_largest_rez_name_size, POS + 0x20u },
+	header_field_t{ "largest_comment_size",  &rez_header_t::m_largest_comment_size,  POS + 0x24u },
+	header_field_t{ "is_sorted",             &rez_header_t::m_is_sorted,             POS + 0x28u }
+};
+
+//
+// key block of the encoded variant (eof1 '*')
+//
+inline constexpr std::array HEADER_ENCODED =
+{
+	header_field_t{ "head",          &rez_header_t::m_head,          0x7Fu },
+	header_field_t{ "encode",        &rez_header_t::m_encode,        0x80u, 32u },
+	header_field_t{ "tail",          &rez_header_t::m_tail,          0xA0u },
+	header_field_t{ "detect_head",   &rez_header_t::m_detect_head,   0xA1u },
+	header_field_t{ "detect_encode", &rez_header_t::m_detect_encode, 0xA2u, 32u },
+	header_field_t{ "detect_tail",   &rez_header_t::m_detect_tail,   0xC2u }
+};
+
+template< std::size_t... N >
+constexpr auto join_fields( const std::array< header_field_t, N >&... fields ) -> std::array< header_field_t, ( N + ... ) >
+{
+	std::array< header_field_t, ( N + ... ) > result{};
+
+	std::size_t i = 0u;
+
+	( ( std::copy( fields.begin(), fields.end(), result.begin() + i ), i += N ), ... );
+
+	return result;
+}
+
+inline constexpr auto HEADER_V1_FIELDS      = join_fields( HEADER_PREFIX, HEADER_FIELDS< 0x7Fu > );
+inline constexpr auto HEADER_V2_FIELDS      = join_fields( HEADER_PREFIX, HEADER_FIELDS< 0x86u > ); // 7 unknown bytes before the version
+inline constexpr auto HEADER_ENCODED_FIELDS = join_fields( HEADER_PREFIX, HEADER_ENCODED, HEADER_FIELDS< 0xC3u > );
+
+/**
+ * @brief head/encode must match their detect copies
+ */
+void validate_encoded_header( const rez_header_t& header );
+
+/**
+ * @brief known variants, probed in order (a new variant is a new entry)
+ */
+inline constexpr std::array HEADER_LAYOUTS =
+{
+	header_layout_t{ "v1",      0x1A, 1u, 0x7Fu, HEADER_V1_FIELDS },
+	header_layout_t{ "v2",      0x1A, 2u, 0x86u, HEADER_V2_FIELDS },
+	header_layout_t{ "encoded", 0x2A, 1u, 0xC3u, HEADER_ENCODED_FIELDS, validate_encoded_header }
+};
+
+inline constexpr std::uint32_t HEADER_PREFIX_SIZE = header_layout_t{ {}, {}, {}, {}, HEADER_PREFIX }.size();
+
+inline constexpr std::uint32_t HEADER_MAX_SIZE = [] ()
+{
+	std::uint32_t size = 0u;
+
+	for ( const auto& layout : HEADER_LAYOUTS )
+		size = std::max( size, layout.size() );
+
+	return size;
+}();
+
+/**
+ * @brief decode the header from the start of the file (up to HEADER_MAX_SIZE bytes)
+ */
+auto parse_header( const std::span< const char > data ) -> rez_header_t;
+
+/**
+ * @brief layout of a parsed header
+ */
+auto header_layout( const rez_header_t& header ) -> const header_layout_t&;
+
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef IO_TUNING_HPP
+#define IO_TUNING_HPP
+
+#pragma once
+
+namespace rez
+{
+
+struct io_tuning_t
+{
+	std::size_t   m_chunk_size{ 0x100000u };
+
+	// chunks of a large resource copied at the same time, 1 copies every resource in order
+	std::size_t   m_concurrency{ 4u };
+
+	// resources from this size on are copied in parallel chunks (see copy_parallel)
+	std::uint64_t m_parallel_threshold{ 0x4000000u };
+};
+
+/**
+ * @brief chunk size/concurrency used by the extraction, see g_calibrate
+ */
+inline io_tuning_t g_io_tuning = {};
+
+/**
+ * @brief the settings given on the command line, calibration keeps them
+ */
+struct io_fixed_t
+{
+	bool m_chunk_size{};
+	bool m_concurrency{};
+};
+
+inline io_fixed_t g_io_fixed = {};
+
+/**
+ * @brief write a few MB with every candidate chunk size and concurrency to the output device (unbuffered)
+ *        and keep the fastest, a larger setting must be at least 10% faster to be picked
+ * @param current the settings, the fixed ones are kept and measured with
+ * @return empty when the device couldn't be measured
+ */
+auto calibrate( const std::filesystem::path& output, const io_tuning_t& current, const io_fixed_t& fixed ) -> std::optional< io_tuning_t >;
+
+/**
+ * @brief calibrate once per run when g_calibrate is set
+ */
+void tune_io( const std::filesystem::path& output );
+
+}
+
+#endif
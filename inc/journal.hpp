@@ -0,0 +1,60 @@
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#pragma once
+
+namespace rez
+{
+
+class c_rez_file;
+
+/**
+ * @brief append only record of the extracted resources, a resumed extraction skips them
+ *
+ * a record is { archive id, directory index, resource index, checksum } (24 bytes, little endian),
+ * a torn record at the end (crash while appending) fails its checksum and is cut off when loading
+ */
+class c_journal
+{
+public:
+	/**
+	 * @brief open (or create) the journal in the output directory and load the finished resources
+	 */
+	c_journal( const std::filesystem::path& output );
+	~c_journal();
+
+	c_journal( const c_journal& ) = delete;
+	c_journal& operator=( const c_journal& ) = delete;
+public:
+	/**
+	 * @brief ".rezextract.journal", every shard (g_shard_index) keeps its own
+	 */
+	static auto filename() -> std::string;
+
+	/**
+	 * @brief identifies the archive content, how its index was built and the options changing the output (not its path)
+	 */
+	static auto archive_id( const c_rez_file& rez ) -> std::uint64_t;
+
+	auto done( const std::uint64_t archive, const std::size_t dir, const std::size_t res ) const -> bool;
+
+	/**
+	 * @brief record a resource, call it once the file was renamed into place
+	 */
+	void complete( const std::uint64_t archive, const std::size_t dir, const std::size_t res );
+
+	/**
+	 * @brief finished resources of an archive
+	 */
+	auto count( const std::uint64_t archive ) const -> std::size_t;
+private:
+	std::filesystem::path                                                    m_path;
+	HANDLE                                                                   m_file;
+
+	std::unordered_map< std::uint64_t, std::unordered_set< std::uint64_t > > m_done;
+	mutable std::mutex                                                       m_mutex;
+};
+
+}
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#pragma once
+
+namespace rez
+{
+
+/**
+ * @brief read only view of a whole file
+ */
+class c_mapped_file
+{
+public:
+	/**
+	 * @param share share mode of the file handle, readers only by default
+	 */
+	c_mapped_file(
+		const std::filesystem::path& path,
+		const DWORD share = FILE_SHARE_READ
+	) :
+		m_file{ INVALID_HANDLE_VALUE },
+		m_mapping{ nullptr },
+		m_data{ nullptr },
+		m_size{ 0u }
+	{
+		m_file = ::CreateFileW(
+			path.wstring().data(),
+			GENERIC_READ,
+			share,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL,
+			nullptr
+		);
+
+		if ( m_file == INVALID_HANDLE_VALUE )
+			REZ_THROW( " - CreateFile: {:s}: {:s}", path.string(), std::system_category().message( ::GetLastError() ) );
+
+		LARGE_INTEGER size{};
+
+		if ( !::GetFileSizeEx( m_file, &size ) )
+		{
+			this->close();
+
+			REZ_THROW( " - GetFileSizeEx: {:s}", std::system_category().message( ::GetLastError() ) );
+		}
+
+		m_size = static_cast< std::uint64_t >( size.QuadPart );
+
+		// empty files can't be mapped
+		if ( m_size == 0u )
+			return;
+
+		m_mapping = ::CreateFileMappingW( m_file, nullptr, PAGE_READONLY, 0u, 0u, nullptr );
+
+		if ( !m_mapping )
+		{
+			this->close();
+
+			REZ_THROW( " - CreateFileMapping: {:s}", std::system_category().message( ::GetLastError() ) );
+		}
+
+		m_data = static_cast< const char* >( ::MapViewOfFile( m_mapping, FILE_MAP_READ, 0u, 0u, 0u ) );
+
+		if ( !m_data )
+		{
+			this->close();
+
+			REZ_THROW( " - MapViewOfFile: {:s}", std::system_category().message( ::GetLastError() ) );
+		}
+	}
+	~c_mapped_file()
+	{
+		this->close();
+	}
+
+	c_mapped_file( const c_mapped_file& ) = delete;
+	c_mapped_file& operator=( const c_mapped_file& ) = delete;
+public:
+	auto data() const -> const char*
+	{
+		return m_data;
+	}
+
+	auto size() const -> std::uint64_t
+	{
+		return m_size;
+	}
+
+	/**
+	 * @brief bounds checked view
+	 */
+	auto view( const std::uint64_t pos, const std::uint64_t size ) const -> std::string_view
+	{
+		if ( pos > m_size || size > m_size - pos )
+			REZ_THROW( " - Invalid view (Pos: {:d} | Size: {:d} | File: {:d})", pos, size, m_size );
+
+		return { m_data + pos, static_cast< std::size_t >( size ) };
+	}
+private:
+	void close()
+	{
+		if ( m_data )
+			::UnmapViewOfFile( m_data );
+
+		if ( m_mapping )
+			::CloseHandle( m_mapping );
+
+		if ( m_file != INVALID_HANDLE_VALUE )
+			::CloseHandle( m_file );
+
+		m_data    = nullptr;
+		m_mapping = nullptr;
+		m_file    = INVALID_HANDLE_VALUE;
+	}
+private:
+	HANDLE        m_file;
+	HANDLE        m_mapping;
+	const char*   m_data;
+	std::uint64_t m_size;
+};
+
+}
+
+#endif
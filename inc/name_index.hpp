@@ -0,0 +1,125 @@
+#ifndef NAME_INDEX_HPP
+#define NAME_INDEX_HPP
+
+#pragma once
+
+namespace rez
+{
+
+class c_rez_file;
+
+struct name_entry_t
+{
+	std::uint32_t m_path{};      // offset in the strings
+	std::uint32_t m_path_size{};
+	std::uint32_t m_desc{};
+	std::uint32_t m_desc_size{};
+	std::uint32_t m_size{};
+	std::uint32_t m_time{};
+};
+
+class c_name_index;
+
+struct name_hit_t
+{
+	const c_name_index* m_index{};
+	std::uint32_t       m_entry{};
+	double              m_score{}; // share of the query trigrams found (fuzzy), 1 for a substring match
+};
+
+/**
+ * @brief trigram index over the resource paths and descriptions of an archive
+ *
+ * every entry is listed under each distinct trigram of its lowercased path and description, a
+ * substring query only verifies the entries listed under all of its trigrams, a fuzzy query
+ * ranks the entries by how many of its trigrams they share
+ */
+class c_name_index
+{
+public:
+	/**
+	 * @brief saved next to the archive ("<archive>.rzidx")
+	 */
+	static constexpr std::string_view EXTENSION = ".rzidx";
+public:
+	/**
+	 * @brief index a loaded archive
+	 */
+	static auto build( c_rez_file& rez ) -> c_name_index;
+
+	/**
+	 * @brief read a saved index, empty when missing, damaged or made for another version of the archive
+	 */
+	static auto load( const std::filesystem::path& archive, const std::uint64_t fingerprint ) -> std::optional< c_name_index >;
+
+	static auto index_path( const std::filesystem::path& archive ) -> std::filesystem::path;
+
+	void save() const;
+
+	/**
+	 * @brief append the matching entries, queries ignore case (lithtech resolves names without it)
+	 * @param fuzzy match entries sharing enough of the query trigrams (a typo or half), typos and reordered words still match
+	 */
+	void find( const std::string_view query, const bool fuzzy, std::vector< name_hit_t >& hits ) const;
+
+	auto path( const std::uint32_t entry ) const -> std::string_view;
+	auto description( const std::uint32_t entry ) const -> std::string_view;
+
+	auto entry( const std::uint32_t entry ) const -> const name_entry_t& { return m_entries[ entry ]; }
+	auto archive() const -> const std::filesystem::path& { return m_archive; }
+	auto size() const -> std::size_t { return m_entries.size(); }
+private:
+	void add_trigrams( const std::uint32_t entry, std::vector< std::uint32_t >& scratch );
+	void lower_strings();
+private:
+	std::filesystem::path                                              m_archive{};
+	std::uint64_t                                                      m_fingerprint{};
+
+	std::vector< name_entry_t >                                        m_entries{};
+	std::string                                                        m_strings{};
+	std::string                                                        m_lower{}; // m_strings lowercased
+
+	// trigram -> entries in ascending order
+	std::unordered_map< std::uint32_t, std::vector< std::uint32_t > > m_trigrams{};
+};
+
+struct name_search_options_t
+{
+	std::size_t m_threads{ std::thread::hardware_concurrency() };
+
+	bool        m_save{};    // write the built indexes next to their archives
+	bool        m_rebuild{}; // ignore the saved indexes
+};
+
+struct name_result_t
+{
+	std::vector< name_hit_t > m_hits{}; // best first, at most the limit
+	std::size_t               m_total{};
+	double                    m_seconds{};
+};
+
+/**
+ * @brief indexes of several archives, opened (loaded or built) in parallel
+ */
+class c_name_search
+{
+public:
+	c_name_search( const std::vector< std::filesystem::path >& file_path, const name_search_options_t& options );
+public:
+	auto find( const std::string_view query, const bool fuzzy, const std::size_t limit ) const -> name_result_t;
+
+	auto indexes() const -> const std::vector< c_name_index >& { return m_indexes; }
+	auto entries() const -> std::size_t;
+
+	auto loaded() const -> std::size_t { return m_loaded; }
+	auto seconds() const -> double { return m_seconds; }
+private:
+	std::vector< c_name_index > m_indexes{};
+
+	std::size_t                 m_loaded{};
+	double                      m_seconds{};
+};
+
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef PACKED_HPP
+#define PACKED_HPP
+
+#pragma once
+
+#include "mapped_file.hpp"
+
+namespace rez
+{
+
+class c_rez_file;
+
+/**
+ * @brief index first container, everything needed for a lookup is at the front
+ *
+ * header | slots | entries | paths | (page aligned) payloads
+ *
+ * the slots are an open addressing hash table (linear probing) over the lowercase
+ * resource paths, so a lookup is a hash, a probe and a compare inside the mapping
+ */
+struct packed_header_t
+{
+	std::array< char, 4u > m_magic{};
+	std::uint32_t          m_version{};
+	std::uint32_t          m_alignment{};
+	std::uint32_t          m_entry_count{};
+	std::uint32_t          m_slot_count{}; // power of two
+	std::uint32_t          m_reserved{};
+	std::uint64_t          m_slots_pos{};
+	std::uint64_t          m_entries_pos{};
+	std::uint64_t          m_paths_pos{};
+	std::uint64_t          m_paths_size{};
+	std::uint64_t          m_file_size{};
+};
+
+struct packed_slot_t
+{
+	std::uint64_t m_hash{};
+	std::uint32_t m_entry{}; // entry index + 1, 0 is empty
+	std::uint32_t m_reserved{};
+};
+
+struct packed_entry_t
+{
+	std::uint64_t m_pos{};
+	std::uint64_t m_size{};
+	std::uint64_t m_path_pos{}; // relative to m_paths_pos
+	std::uint32_t m_path_size{};
+	std::uint32_t m_time{};
+};
+
+/**
+ * @brief convert a rez archive into the packed container
+ * @param alignment payload alignment, power of two
+ */
+void write_packed( c_rez_file& rez, const std::filesystem::path& output, const std::uint32_t alignment = 0x1000u );
+
+/**
+ * @brief packed container opened with a single mapping, nothing is parsed up front
+ */
+class c_packed_file
+{
+public:
+	c_packed_file( const std::filesystem::path& path );
+	~c_packed_file() = default;
+public:
+	auto find( const std::string_view path ) const -> const packed_entry_t*;
+
+	auto path( const packed_entry_t& entry ) const -> std::string_view;
+	auto data( const packed_entry_t& entry ) const -> std::string_view;
+
+	auto entries() const -> std::span< const packed_entry_t >
+	{
+		return { m_entries, m_header->m_entry_count };
+	}
+private:
+	c_mapped_file          m_file;
+
+	const packed_header_t* m_header;
+	const packed_slot_t*   m_slots;
+	const packed_entry_t*  m_entries;
+	const char*            m_paths;
+};
+
+/**
+ * @brief hash used by the slots
+ */
+auto packed_hash( const std::string_view path ) -> std::uint64_t;
+
+}
+
+#endif
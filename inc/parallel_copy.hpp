@@ -0,0 +1,134 @@
+#ifndef PARALLEL_COPY_HPP
+#define PARALLEL_COPY_HPP
+
+#pragma once
+
+namespace rez
+{
+
+struct block_resource_t;
+
+/**
+ * @brief file opened for overlapped I/O, positional reads/writes from several threads run concurrently
+ *        (a synchronous handle serializes them)
+ */
+class c_positional_file
+{
+public:
+	c_positional_file(
+		const std::filesystem::path& path,
+		const DWORD access,
+		const DWORD share,
+		const DWORD disposition
+	) :
+		m_path{ path },
+		m_file{ INVALID_HANDLE_VALUE }
+	{
+		m_file = ::CreateFileW(
+			path.wstring().data(),
+			access,
+			share,
+			nullptr,
+			disposition,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,
+			nullptr
+		);
+
+		if ( m_file == INVALID_HANDLE_VALUE )
+			REZ_THROW( " - CreateFile: {:s}: {:s}", path.string(), std::system_category().message( ::GetLastError() ) );
+	}
+	~c_positional_file()
+	{
+		if ( m_file != INVALID_HANDLE_VALUE )
+			::CloseHandle( m_file );
+	}
+
+	c_positional_file( const c_positional_file& ) = delete;
+	c_positional_file& operator=( const c_positional_file& ) = delete;
+public:
+	/**
+	 * @param event manual reset event owned by the calling thread
+	 */
+	void read_at( const std::uint64_t pos, char* data, const std::uint32_t size, const HANDLE event ) const
+	{
+		OVERLAPPED overlapped = this->overlapped( pos, event );
+
+		DWORD bytes = 0u;
+
+		if ( !::ReadFile( m_file, data, size, nullptr, &overlapped ) && ::GetLastError() != ERROR_IO_PENDING )
+			REZ_THROW( " - ReadFile: {:s}: {:s}", m_path.string(), std::system_category().message( ::GetLastError() ) );
+
+		if ( !::GetOverlappedResult( m_file, &overlapped, &bytes, TRUE ) || bytes != size )
+			REZ_THROW( " - ReadFile: {:s}: short read (Pos: {:d} | Size: {:d} | Read: {:d})", m_path.string(), pos, size, bytes );
+	}
+
+	void write_at( const std::uint64_t pos, const char* data, const std::uint32_t size, const HANDLE event ) const
+	{
+		OVERLAPPED overlapped = this->overlapped( pos, event );
+
+		DWORD bytes = 0u;
+
+		if ( !::WriteFile( m_file, data, size, nullptr, &overlapped ) && ::GetLastError() != ERROR_IO_PENDING )
+			REZ_THROW( " - WriteFile: {:s}: {:s}", m_path.string(), std::system_category().message( ::GetLastError() ) );
+
+		if ( !::GetOverlappedResult( m_file, &overlapped, &bytes, TRUE ) || bytes != size )
+			REZ_THROW( " - WriteFile: {:s}: {:s}", m_path.string(), std::system_category().message( ::GetLastError() ) );
+	}
+
+	/**
+	 * @brief reserve the clusters up front, the file gets one contiguous allocation instead of growing per write
+	 */
+	void preallocate( const std::uint64_t size ) const
+	{
+		FILE_ALLOCATION_INFO info{};
+
+		info.AllocationSize.QuadPart = static_cast< LONGLONG >( size );
+
+		// only a hint, the writes extend the file anyway
+		::SetFileInformationByHandle( m_file, FileAllocationInfo, &info, sizeof( info ) );
+	}
+
+	void set_size( const std::uint64_t size ) const
+	{
+		FILE_END_OF_FILE_INFO info{};
+
+		info.EndOfFile.QuadPart = static_cast< LONGLONG >( size );
+
+		if ( !::SetFileInformationByHandle( m_file, FileEndOfFileInfo, &info, sizeof( info ) ) )
+			REZ_THROW( " - SetEndOfFile: {:s}: {:s}", m_path.string(), std::system_category().message( ::GetLastError() ) );
+	}
+
+	auto handle() const -> HANDLE { return m_file; }
+private:
+	static auto overlapped( const std::uint64_t pos, const HANDLE event ) -> OVERLAPPED
+	{
+		OVERLAPPED overlapped{};
+
+		overlapped.Offset     = static_cast< DWORD >( pos );
+		overlapped.OffsetHigh = static_cast< DWORD >( pos >> 32u );
+		overlapped.hEvent     = event;
+
+		return overlapped;
+	}
+private:
+	std::filesystem::path m_path;
+	HANDLE                m_file;
+};
+
+struct parallel_copy_t
+{
+	std::uint64_t m_bytes{};
+	std::uint64_t m_skipped{}; // left as holes (g_sparse)
+};
+
+/**
+ * @brief copy a resource with g_io_tuning.m_concurrency chunks in flight, see g_io_tuning.m_parallel_threshold
+ *
+ * every thread takes the next chunk in file order, so the writes stay close to each other and the
+ * file system never zero fills a large gap ahead of the valid data
+ */
+auto copy_parallel( const std::filesystem::path& archive, const block_resource_t& res, const std::filesystem::path& output ) -> parallel_copy_t;
+
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef PATCH_HPP
+#define PATCH_HPP
+
+#pragma once
+
+namespace rez
+{
+
+class c_rez_file;
+
+/**
+ * @brief delta patch layout
+ *
+ * header | ops
+ *
+ * the ops rebuild the new archive front to back: a copy takes a range of the old archive, a
+ * literal carries its bytes right after the op. the header, the directory blocks and every
+ * new or changed payload end up in literals, so applying is a single pass over the patch
+ */
+struct patch_header_t
+{
+	std::array< char, 4u > m_magic{};
+	std::uint32_t          m_version{};
+	std::uint64_t          m_old_size{};
+	std::uint64_t          m_old_hash{}; // fnv1a of the old archive header
+	std::uint64_t          m_new_size{};
+	std::uint64_t          m_new_hash{}; // fnv1a of the whole new archive
+	std::uint64_t          m_op_count{};
+};
+
+struct patch_op_t
+{
+	std::uint32_t m_type{};
+	std::uint32_t m_reserved{};
+	std::uint64_t m_pos{};  // old archive position (copy)
+	std::uint64_t m_size{};
+};
+
+enum patch_op_type_
+{
+	patch_op_type_copy    = 0,
+	patch_op_type_literal = 1
+};
+
+struct patch_options_t
+{
+	// changed resources this large are compared in 64K blocks against the old one at the same path
+	std::uint64_t m_delta_threshold{ 0x100000u };
+};
+
+struct patch_stats_t
+{
+	// index comparison by path, size and time
+	std::size_t   m_added{};
+	std::size_t   m_removed{};
+	std::size_t   m_modified{};
+	std::size_t   m_unchanged{};
+
+	// payloads copied whole from the old archive (same content, any path)
+	std::size_t   m_copied{};
+	std::size_t   m_delta{};
+
+	std::uint64_t m_copy_bytes{};
+	std::uint64_t m_literal_bytes{};
+	std::uint64_t m_op_count{};
+	std::uint64_t m_patch_size{};
+	std::uint64_t m_new_size{};
+};
+
+/**
+ * @brief write a patch turning the old archive into the new one
+ *
+ * payloads are matched by content hash first (unchanged, moved or renamed resources cost a copy
+ * op), a changed resource at the same path above m_delta_threshold keeps its unchanged blocks
+ */
+auto write_patch( c_rez_file& old_rez, c_rez_file& new_rez, const std::filesystem::path& output, const patch_options_t& options = {} ) -> patch_stats_t;
+
+/**
+ * @brief rebuild the new archive from the old one and a patch, the output is removed unless it hashes as expected
+ */
+auto apply_patch( const std::filesystem::path& old_path, const std::filesystem::path& patch, const std::filesystem::path& output ) -> patch_stats_t;
+
+}
+
+#endif
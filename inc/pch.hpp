@@ -11,24 +11,48 @@
 #include <objbase.h>
 #include <shlobj_core.h>
 #include <wrl/client.h>
+#include <winsock2.h>
+#include <afunix.h>
+#include <compressapi.h>
+#include <emmintrin.h>
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
+#include <cctype>
 #include <charconv>
 #include <chrono>
 #include <clocale>
+#include <condition_variable>
+#include <coroutine>
 #include <cstdint>
+#include <cstring>
+#include <deque>
 #include <iostream>
 #include <filesystem>
 #include <format>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <locale>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <shared_mutex>
 #include <source_location>
+#include <span>
 #include <string>
 #include <string_view>
 #include <stdexcept>
+#include <stop_token>
 #include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
 #include <vector>
 
 #include "utilities.hpp"
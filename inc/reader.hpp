@@ -46,6 +46,24 @@ public:
 			REZ_THROW( " - ifstream: invalid read (Expected: {:d} | Current: {:d}", size, m_stream.gcount() );
 	}
 
+	/**
+	 * @brief read up to size bytes, stopping at the end of the file is not an error
+	 */
+	auto read_some( char* data, const std::size_t size ) -> std::size_t
+	{
+		const auto exceptions = m_stream.exceptions();
+
+		m_stream.exceptions( std::ifstream::badbit );
+		m_stream.read( data, static_cast< std::streamsize >( size ) );
+
+		const auto count = static_cast< std::size_t >( m_stream.gcount() );
+
+		m_stream.clear();
+		m_stream.exceptions( exceptions );
+
+		return count;
+	}
+
 	template< typename T = std::uint32_t >
 	auto read() -> T
 	{
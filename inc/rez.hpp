@@ -8,7 +8,59 @@ namespace rez
 
 inline bool g_dtx_to_lithtech = false;
 
-void extract( const std::vector<std::filesystem::path>& file_path, const std::filesystem::path& save_path );
+/**
+ * @brief buffer pool budget (see c_buffer_pool)
+ */
+inline std::uint64_t g_memory_budget = 256ull << 20u;
+inline bool          g_large_pages   = false;
+
+/**
+ * @brief measure the output device before extracting and pick the chunk size/concurrency
+ */
+inline bool          g_calibrate     = false;
+
+/**
+ * @brief parse the directory blocks on every core
+ */
+inline bool          g_parallel_index = true;
+
+/**
+ * @brief scan archives that fail to load for directory entries instead of skipping them
+ */
+inline bool          g_salvage = false;
+
+/**
+ * @brief leave the all zero blocks of the extracted files as holes (see c_writer)
+ */
+inline bool          g_sparse = false;
+
+/**
+ * @brief extract only shard g_shard_index of g_shard_count (see plan_shards), 1 extracts everything
+ */
+inline std::uint32_t g_shard_index = 0u;
+inline std::uint32_t g_shard_count = 1u;
+
+/**
+ * @brief seconds the other shards wait for shard 0's directories, shards on other machines may start a while after it
+ */
+inline std::uint32_t g_shard_wait = 1800u;
+
+/**
+ * @brief skip the resources recorded in the output's journal by an earlier run (see c_journal)
+ */
+inline bool          g_resume = false;
+
+/**
+ * @return the archives that couldn't be extracted completely
+ */
+auto extract( const std::vector<std::filesystem::path>& file_path, const std::filesystem::path& save_path ) -> std::size_t;
+
+/**
+ * @brief extract layered archives, a resource path in a later archive overrides the same path in an earlier one
+ * @param report log every shadowed resource
+ * @return the archives that couldn't be loaded or extracted completely
+ */
+auto extract_overlay( const std::vector<std::filesystem::path>& file_path, const std::filesystem::path& save_path, const bool report ) -> std::size_t;
 
 }
 
@@ -0,0 +1,114 @@
+#ifndef REZ_FILE_HPP
+#define REZ_FILE_HPP
+
+#pragma once
+
+#include "block.hpp"
+#include "header.hpp"
+#include "reader.hpp"
+
+namespace rez
+{
+
+/**
+ * @brief how the index of an archive was built, the resource indices are only comparable for the same one
+ */
+enum index_source_
+{
+	index_source_none      = 0,
+	index_source_recursive = 1,
+	index_source_parallel  = 2,
+	index_source_salvage   = 3
+};
+
+/**
+ * @brief represents a rez file
+ */
+class c_rez_file
+{
+public:
+	//
+	// return false to skip the resource (directory index, resource index)
+	//
+	using filter_t = std::function< bool( const std::size_t, const std::size_t ) >;
+
+	//
+	// called once a resource is in place (directory index, resource index)
+	//
+	using done_t = std::function< void( const std::size_t, const std::size_t ) >;
+public:
+	c_rez_file( const std::filesystem::path& input ) :
+		m_reader{ input },
+		m_path{ input }
+	{
+	}
+public:
+	void load();
+	void read_index();
+
+	/**
+	 * @brief rebuild the index by scanning the whole file, for archives with a damaged header/tree
+	 */
+	void salvage();
+
+	/**
+	 * @return the resources that couldn't be extracted, the others are extracted regardless
+	 */
+	auto extract( const std::filesystem::path& output, const filter_t& filter = {}, const done_t& done = {} ) -> std::size_t;
+
+	/**
+	 * @brief create every directory of the index under output
+	 */
+	void create_directories( const std::filesystem::path& output ) const;
+
+	/**
+	 * @brief find a resource by path (i.e "textures/sky.dtx"), only the directory blocks along the path are read
+	 */
+	auto find( const std::string_view path ) -> std::optional< block_resource_t >;
+
+	/**
+	 * @brief read raw archive data
+	 */
+	void read_at( const std::uint32_t pos, char* data, const std::uint32_t size );
+
+	/**
+	 * @brief read the whole resource data
+	 */
+	auto read_resource( const block_resource_t& res ) -> std::vector< char >;
+
+	/**
+	 * @brief path of a directory relative to the archive root
+	 */
+	auto directory_path( const std::size_t index ) const -> std::filesystem::path;
+
+	/**
+	 * @brief resource name with the extension appended
+	 */
+	static auto resource_filename( const block_resource_t& res ) -> std::string;
+
+	/**
+	 * @brief fix the DTX version offset in the first bytes of a resource (see g_dtx_to_lithtech)
+	 */
+	static void convert_dtx( const block_resource_t& res, char* data, const std::size_t size );
+
+	/**
+	 * @brief identifies this version of the archive (size and header), not its path
+	 */
+	auto fingerprint() const -> std::uint64_t;
+
+	auto path() const -> const std::filesystem::path& { return m_path; }
+	auto header() const -> const rez_header_t& { return m_header; }
+	auto index() const -> const rez_t& { return m_rez; }
+	auto index_source() const -> index_source_ { return m_index_source; }
+private:
+	c_reader              m_reader;
+	std::filesystem::path m_path;
+
+	rez_header_t          m_header;
+	rez_t                 m_rez;
+	index_source_         m_index_source{ index_source_none };
+};
+
+}
+
+#endif
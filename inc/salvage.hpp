@@ -0,0 +1,39 @@
+#ifndef SALVAGE_HPP
+#define SALVAGE_HPP
+
+#pragma once
+
+#include "block.hpp"
+
+namespace rez
+{
+
+class c_mapped_file;
+class c_thread_pool;
+
+struct salvage_stats_t
+{
+	std::uint64_t m_candidates{};
+	std::uint64_t m_blocks{};
+	std::uint64_t m_roots{};
+	std::uint64_t m_directories{};
+	std::uint64_t m_resources{};
+	std::uint64_t m_orphans{};
+	std::uint64_t m_dropped{};
+	double        m_seconds{};
+};
+
+/**
+ * @brief rebuild the directory tree of a damaged archive without the header
+ *
+ * the whole file is scanned for plausible directory entries (block_header_t type 0/1,
+ * pos/size inside the file, NUL terminated names, reversed extension), then the blocks
+ * referenced by directory entries are walked as far as their entries chain up, chains
+ * nothing references become root blocks and runs of resources nothing owns are kept
+ * under a "_salvaged" directory
+ */
+auto salvage_index( const c_mapped_file& file, c_thread_pool& pool, salvage_stats_t& stats ) -> rez_t;
+
+}
+
+#endif
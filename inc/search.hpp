@@ -0,0 +1,173 @@
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+#pragma once
+
+namespace rez
+{
+
+/**
+ * @brief multi pattern substring matcher
+ *
+ * SSE2 filter on the first and last byte of a pattern 16 positions at a time, only the
+ * positions where both match are compared, so the scan runs at memory speed on data the
+ * patterns don't occur in
+ */
+class c_matcher
+{
+public:
+	c_matcher(
+		const std::vector< std::string >& patterns,
+		const bool ignore_case = false
+	) :
+		m_ignore_case{ ignore_case },
+		m_longest{ 0u }
+	{
+		for ( const auto& text : patterns )
+		{
+			if ( text.empty() )
+				REZ_THROW( " - Empty search pattern" );
+
+			pattern_t pattern{ m_ignore_case ? to_lower( text ) : text };
+
+			pattern.m_first_lower = _mm_set1_epi8( pattern.m_text.front() );
+			pattern.m_first_upper = _mm_set1_epi8( this->upper( pattern.m_text.front() ) );
+			pattern.m_last_lower  = _mm_set1_epi8( pattern.m_text.back() );
+			pattern.m_last_upper  = _mm_set1_epi8( this->upper( pattern.m_text.back() ) );
+
+			m_longest = std::max( m_longest, text.size() );
+
+			m_patterns.emplace_back( std::move( pattern ) );
+		}
+	}
+public:
+	/**
+	 * @brief call hit( offset, pattern index ) for every match starting before starts
+	 *
+	 * data may extend past starts by up to longest() - 1 bytes so a match crossing the end of
+	 * a slice is still found (and only by the slice it starts in)
+	 */
+	template< typename F >
+	void scan( const char* data, const std::size_t size, const std::size_t starts, F&& hit ) const
+	{
+		for ( std::size_t p = 0u; p < m_patterns.size(); ++p )
+			this->scan_pattern( m_patterns[ p ], data, size, std::min( starts, size ), [&] ( const std::size_t offset ) { hit( offset, p ); } );
+	}
+
+	auto pattern( const std::size_t index ) const -> const std::string& { return m_patterns[ index ].m_text; }
+	auto longest() const -> std::size_t { return m_longest; }
+private:
+	struct pattern_t
+	{
+		std::string m_text{};
+
+		__m128i     m_first_lower{};
+		__m128i     m_first_upper{};
+		__m128i     m_last_lower{};
+		__m128i     m_last_upper{};
+	};
+
+	auto upper( const char ch ) const -> char
+	{
+		return m_ignore_case ? static_cast< char >( std::toupper( static_cast< unsigned char >( ch ) ) ) : ch;
+	}
+
+	auto equal( const char* data, const std::string& text ) const -> bool
+	{
+		if ( !m_ignore_case )
+			return std::memcmp( data, text.data(), text.size() ) == 0;
+
+		for ( std::size_t i = 0u; i < text.size(); ++i )
+		{
+			if ( std::tolower( static_cast< unsigned char >( data[ i ] ) ) != static_cast< unsigned char >( text[ i ] ) )
+				return false;
+		}
+
+		return true;
+	}
+
+	template< typename F >
+	void scan_pattern( const pattern_t& pattern, const char* data, const std::size_t size, const std::size_t starts, F&& hit ) const
+	{
+		const auto length = pattern.m_text.size();
+
+		if ( size < length )
+			return;
+
+		// last position a match can start at
+		const auto last = std::min( starts, size - length + 1u );
+
+		std::size_t i = 0u;
+
+		for ( ; i + 16u <= last && i + length - 1u + 16u <= size; i += 16u )
+		{
+			const auto first = _mm_loadu_si128( reinterpret_cast< const __m128i* >( data + i ) );
+			const auto tail  = _mm_loadu_si128( reinterpret_cast< const __m128i* >( data + i + length - 1u ) );
+
+			const auto eq_first = _mm_or_si128( _mm_cmpeq_epi8( first, pattern.m_first_lower ), _mm_cmpeq_epi8( first, pattern.m_first_upper ) );
+			const auto eq_last  = _mm_or_si128( _mm_cmpeq_epi8( tail, pattern.m_last_lower ), _mm_cmpeq_epi8( tail, pattern.m_last_upper ) );
+
+			for ( auto mask = static_cast< unsigned >( _mm_movemask_epi8( _mm_and_si128( eq_first, eq_last ) ) ); mask; mask &= mask - 1u )
+			{
+				const auto offset = i + static_cast< std::size_t >( std::countr_zero( mask ) );
+
+				if ( this->equal( data + offset, pattern.m_text ) )
+					hit( offset );
+			}
+		}
+
+		for ( ; i < last; ++i )
+		{
+			if ( this->equal( data + i, pattern.m_text ) )
+				hit( i );
+		}
+	}
+private:
+	std::vector< pattern_t > m_patterns;
+	bool                     m_ignore_case;
+	std::size_t              m_longest;
+};
+
+struct search_options_t
+{
+	std::vector< std::string > m_patterns{};
+
+	// extensions to search (lowercase, without the dot), empty searches every resource
+	std::vector< std::string > m_types{};
+
+	bool                       m_ignore_case{};
+	std::size_t                m_threads{ std::thread::hardware_concurrency() };
+};
+
+struct search_hit_t
+{
+	std::filesystem::path m_archive{};
+	std::string           m_path{};
+	std::uint64_t         m_offset{}; // inside the resource
+	std::size_t           m_pattern{};
+};
+
+struct search_stats_t
+{
+	std::size_t   m_archives{};
+	std::size_t   m_resources{};
+	std::uint64_t m_bytes{};
+	std::size_t   m_hits{};
+	double        m_seconds{};
+};
+
+/**
+ * @brief search the resource payloads of every archive, nothing is written
+ *
+ * the payloads are scanned from a mapping of the archive in parallel slices, the next archive
+ * is indexed while the current one is scanned, hits come out in archive then offset order
+ */
+auto search_archives(
+	const std::vector< std::filesystem::path >& file_path,
+	const search_options_t& options,
+	const std::function< void( const search_hit_t& ) >& on_hit
+) -> search_stats_t;
+
+}
+
+#endif
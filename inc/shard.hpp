@@ -0,0 +1,56 @@
+#ifndef SHARD_HPP
+#define SHARD_HPP
+
+#pragma once
+
+#include "block.hpp"
+
+namespace rez
+{
+
+class c_rez_file;
+
+/**
+ * @brief archive offsets owned by a shard
+ */
+struct shard_range_t
+{
+	std::uint32_t m_begin{};
+	std::uint64_t m_end{}; // one past the last byte, up to 4G + 4G
+	std::uint64_t m_bytes{};
+	std::size_t   m_resources{};
+};
+
+struct shard_plan_t
+{
+	// shard of every resource, [directory][resource]
+	std::vector< std::vector< std::uint32_t > > m_shard{};
+	std::vector< shard_range_t >                m_ranges{};
+};
+
+/**
+ * @brief "i/N" with i < N, shards are numbered from 0
+ */
+void parse_shard( const std::string_view value, std::uint32_t& index, std::uint32_t& count );
+
+/**
+ * @brief split the resources into count contiguous offset ranges holding about the same bytes
+ *
+ * only depends on the index (ties are broken by directory/resource index), every process
+ * computes the same plan and re-running a shard extracts the same resources
+ */
+auto plan_shards( const rez_t& index, const std::uint32_t count ) -> shard_plan_t;
+
+/**
+ * @brief shard 0 creates every directory and then the marker, the others wait for the marker
+ *
+ * the marker (".<archive>.shards" in output) keeps the shards from racing on the skeleton,
+ * a stale one from a different archive is not trusted
+ *
+ * @param wait how long the other shards wait for the marker, 0 fails right away when it's missing
+ */
+void prepare_shard( const c_rez_file& rez, const std::filesystem::path& output, const std::uint32_t index, const std::chrono::seconds wait );
+
+}
+
+#endif
@@ -0,0 +1,473 @@
+#ifndef TASK_HPP
+#define TASK_HPP
+
+#pragma once
+
+namespace rez
+{
+
+/**
+ * @brief runs resumed coroutines, implement it to put the work on an existing event loop/thread pool
+ */
+class c_executor
+{
+public:
+	virtual ~c_executor() = default;
+
+	/**
+	 * @brief resume handle later on some thread, higher priorities first
+	 */
+	virtual void post( std::coroutine_handle<> handle, const int priority ) = 0;
+};
+
+/**
+ * @brief fixed size pool of worker threads with a priority queue, FIFO within a priority
+ */
+class c_pool_executor final : public c_executor
+{
+public:
+	c_pool_executor(
+		const std::size_t count = std::thread::hardware_concurrency()
+	) :
+		m_sequence{ 0u },
+		m_stop{ false }
+	{
+		const auto workers = std::max< std::size_t >( count, 1u );
+
+		m_workers.reserve( workers );
+
+		for ( std::size_t i = 0u; i < workers; ++i )
+			m_workers.emplace_back( [this] { this->work(); } );
+	}
+	~c_pool_executor() override
+	{
+		{
+			std::scoped_lock lock{ m_mutex };
+
+			m_stop = true;
+		}
+
+		m_cv.notify_all();
+
+		for ( auto& worker : m_workers )
+			worker.join();
+	}
+
+	c_pool_executor( const c_pool_executor& ) = delete;
+	c_pool_executor& operator=( const c_pool_executor& ) = delete;
+public:
+	void post( std::coroutine_handle<> handle, const int priority ) override
+	{
+		{
+			std::scoped_lock lock{ m_mutex };
+
+			m_queue.push( { priority, m_sequence++, handle } );
+		}
+
+		m_cv.notify_one();
+	}
+private:
+	struct item_t
+	{
+		int                     m_priority;
+		std::uint64_t           m_sequence;
+		std::coroutine_handle<> m_handle;
+
+		auto operator<( const item_t& other ) const -> bool
+		{
+			if ( m_priority != other.m_priority )
+				return m_priority < other.m_priority;
+
+			return m_sequence > other.m_sequence;
+		}
+	};
+
+	void work()
+	{
+		while ( true )
+		{
+			std::coroutine_handle<> handle{};
+
+			{
+				std::unique_lock lock{ m_mutex };
+
+				m_cv.wait( lock, [this] { return m_stop || !m_queue.empty(); } );
+
+				// the queue is drained before stopping, a posted coroutine always gets to finish
+				if ( m_queue.empty() )
+					return;
+
+				handle = m_queue.top().m_handle;
+
+				m_queue.pop();
+			}
+
+			handle.resume();
+		}
+	}
+private:
+	std::vector< std::thread >          m_workers;
+	std::priority_queue< item_t >       m_queue;
+	std::uint64_t                       m_sequence;
+
+	std::mutex                          m_mutex;
+	std::condition_variable             m_cv;
+	bool                                m_stop;
+};
+
+/**
+ * @brief thrown by a task that saw its stop token
+ */
+class c_cancelled : public std::runtime_error
+{
+public:
+	c_cancelled() :
+		std::runtime_error{ " - Cancelled" }
+	{
+	}
+};
+
+inline void throw_if_cancelled( const std::stop_token& stop )
+{
+	if ( stop.stop_requested() )
+		throw c_cancelled{};
+}
+
+/**
+ * @brief continue the awaiting coroutine on the executor
+ */
+struct schedule_t
+{
+	c_executor& m_executor;
+	int         m_priority;
+
+	auto await_ready() const noexcept -> bool { return false; }
+	void await_suspend( std::coroutine_handle<> handle ) const { m_executor.post( handle, m_priority ); }
+	void await_resume() const noexcept {}
+};
+
+inline auto schedule( c_executor& executor, const int priority = 0 ) -> schedule_t
+{
+	return { executor, priority };
+}
+
+namespace internal
+{
+
+template< typename T >
+struct task_result_t
+{
+	std::variant< std::monostate, T, std::exception_ptr > m_result{};
+
+	template< typename U >
+	void return_value( U&& value )
+	{
+		m_result.template emplace< 1u >( std::forward< U >( value ) );
+	}
+
+	void unhandled_exception()
+	{
+		m_result.template emplace< 2u >( std::current_exception() );
+	}
+
+	auto result() -> T
+	{
+		if ( m_result.index() == 2u )
+			std::rethrow_exception( std::get< 2u >( m_result ) );
+
+		return std::move( std::get< 1u >( m_result ) );
+	}
+};
+
+template<>
+struct task_result_t< void >
+{
+	std::exception_ptr m_exception{};
+
+	void return_void() {}
+
+	void unhandled_exception()
+	{
+		m_exception = std::current_exception();
+	}
+
+	void result()
+	{
+		if ( m_exception )
+			std::rethrow_exception( m_exception );
+	}
+};
+
+/**
+ * @brief started as soon as it is called, nothing waits for it
+ */
+struct detached_t
+{
+	struct promise_type
+	{
+		auto get_return_object() noexcept -> detached_t { return {}; }
+		auto initial_suspend() noexcept -> std::suspend_never { return {}; }
+		auto final_suspend() noexcept -> std::suspend_never { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { std::terminate(); }
+	};
+};
+
+}
+
+/**
+ * @brief lazy coroutine, runs when awaited and resumes the awaiting coroutine when done
+ */
+template< typename T = void >
+class c_task
+{
+public:
+	struct promise_type : internal::task_result_t< T >
+	{
+		std::coroutine_handle<> m_continuation{};
+
+		auto get_return_object() noexcept -> c_task
+		{
+			return c_task{ std::coroutine_handle< promise_type >::from_promise( *this ) };
+		}
+
+		auto initial_suspend() noexcept -> std::suspend_always { return {}; }
+
+		auto final_suspend() noexcept
+		{
+			struct final_t
+			{
+				auto await_ready() const noexcept -> bool { return false; }
+
+				auto await_suspend( std::coroutine_handle< promise_type > handle ) const noexcept -> std::coroutine_handle<>
+				{
+					if ( const auto continuation = handle.promise().m_continuation )
+						return continuation;
+
+					return std::noop_coroutine();
+				}
+
+				void await_resume() const noexcept {}
+			};
+
+			return final_t{};
+		}
+	};
+public:
+	c_task() = default;
+	c_task( c_task&& other ) noexcept :
+		m_handle{ std::exchange( other.m_handle, nullptr ) }
+	{
+	}
+	c_task& operator=( c_task&& other ) noexcept
+	{
+		if ( this != &other )
+		{
+			if ( m_handle )
+				m_handle.destroy();
+
+			m_handle = std::exchange( other.m_handle, nullptr );
+		}
+
+		return *this;
+	}
+	~c_task()
+	{
+		if ( m_handle )
+			m_handle.destroy();
+	}
+
+	c_task( const c_task& ) = delete;
+	c_task& operator=( const c_task& ) = delete;
+public:
+	auto operator co_await() && noexcept
+	{
+		struct awaiter_t
+		{
+			std::coroutine_handle< promise_type > m_handle;
+
+			auto await_ready() const noexcept -> bool { return !m_handle || m_handle.done(); }
+
+			// symmetric transfer, a chain of tasks doesn't grow the stack
+			auto await_suspend( std::coroutine_handle<> continuation ) const noexcept -> std::coroutine_handle<>
+			{
+				m_handle.promise().m_continuation = continuation;
+
+				return m_handle;
+			}
+
+			auto await_resume() const -> T
+			{
+				return m_handle.promise().result();
+			}
+		};
+
+		return awaiter_t{ m_handle };
+	}
+private:
+	explicit c_task( std::coroutine_handle< promise_type > handle ) :
+		m_handle{ handle }
+	{
+	}
+private:
+	std::coroutine_handle< promise_type > m_handle{};
+};
+
+namespace internal
+{
+
+//
+// free functions rather than lambdas, a lambda coroutine's captures don't live in its frame
+//
+inline auto run_detached( c_task<> task, std::function< void( std::exception_ptr ) > done ) -> detached_t
+{
+	std::exception_ptr exception{};
+
+	try
+	{
+		co_await std::move( task );
+	}
+	catch ( ... )
+	{
+		exception = std::current_exception();
+	}
+
+	if ( done )
+		done( exception );
+}
+
+template< typename T >
+auto run_blocking( c_task< T > task, task_result_t< T >& result, std::promise< void > finished ) -> detached_t
+{
+	try
+	{
+		if constexpr ( std::is_void_v< T > )
+		{
+			co_await std::move( task );
+
+			result.return_void();
+		}
+		else
+		{
+			result.return_value( co_await std::move( task ) );
+		}
+	}
+	catch ( ... )
+	{
+		result.unhandled_exception();
+	}
+
+	finished.set_value();
+}
+
+template< typename T >
+struct when_all_state_t
+{
+	std::atomic< std::size_t > m_pending{};
+	std::coroutine_handle<>    m_continuation{};
+
+	std::vector< T >           m_results{};
+	std::exception_ptr         m_exception{};
+	std::mutex                 m_mutex{};
+};
+
+template< typename T >
+auto run_when_all( c_task< T > task, std::shared_ptr< when_all_state_t< T > > state, const std::size_t index ) -> detached_t
+{
+	try
+	{
+		state->m_results[ index ] = co_await std::move( task );
+	}
+	catch ( ... )
+	{
+		std::scoped_lock lock{ state->m_mutex };
+
+		if ( !state->m_exception )
+			state->m_exception = std::current_exception();
+	}
+
+	if ( --state->m_pending == 0u )
+		state->m_continuation.resume();
+}
+
+}
+
+/**
+ * @brief start a task without waiting for it, done gets the exception (if any) on the thread that finished it
+ */
+inline void spawn( c_task<> task, std::function< void( std::exception_ptr ) > done )
+{
+	internal::run_detached( std::move( task ), std::move( done ) );
+}
+
+/**
+ * @brief block the calling thread until the task finished, never call it from an executor thread
+ */
+template< typename T >
+auto sync_wait( c_task< T > task ) -> T
+{
+	internal::task_result_t< T > result{};
+	std::promise< void >         finished{};
+
+	auto future = finished.get_future();
+
+	// the promise lives in the coroutine frame, this thread may return as soon as it is set
+	internal::run_blocking( std::move( task ), result, std::move( finished ) );
+
+	future.wait();
+
+	return result.result();
+}
+
+/**
+ * @brief run every task concurrently, the results keep the order of the tasks
+ *
+ * the first exception is rethrown once all of them finished
+ */
+template< typename T >
+auto when_all( std::vector< c_task< T > > tasks ) -> c_task< std::vector< T > >
+{
+	using state_t = internal::when_all_state_t< T >;
+
+	auto state = std::make_shared< state_t >();
+
+	state->m_results.resize( tasks.size() );
+
+	struct awaiter_t
+	{
+		// references to the frame's locals, the awaiter holds no ownership of its own
+		std::vector< c_task< T > >&       m_tasks;
+		const std::shared_ptr< state_t >& m_state;
+
+		auto await_ready() const noexcept -> bool { return m_tasks.empty(); }
+
+		auto await_suspend( std::coroutine_handle<> continuation ) -> bool
+		{
+			//
+			// one extra count held by this function, a task that finishes right away can't resume
+			// the continuation while the others are still being started
+			//
+			m_state->m_pending      = m_tasks.size() + 1u;
+			m_state->m_continuation = continuation;
+
+			for ( std::size_t i = 0u; i < m_tasks.size(); ++i )
+				internal::run_when_all( std::move( m_tasks[ i ] ), m_state, i );
+
+			// false resumes the awaiting coroutine right away, every task already finished
+			return --m_state->m_pending != 0u;
+		}
+
+		void await_resume() const noexcept {}
+	};
+
+	co_await awaiter_t{ tasks, state };
+
+	if ( state->m_exception )
+		std::rethrow_exception( state->m_exception );
+
+	co_return std::move( state->m_results );
+}
+
+}
+
+#endif
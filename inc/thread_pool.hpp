@@ -0,0 +1,112 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#pragma once
+
+namespace rez
+{
+
+/**
+ * @brief fixed size pool of worker threads
+ */
+class c_thread_pool
+{
+public:
+	c_thread_pool(
+		const std::size_t count = std::thread::hardware_concurrency()
+	) :
+		m_stop{ false }
+	{
+		const auto workers = std::max< std::size_t >( count, 1u );
+
+		m_workers.reserve( workers );
+
+		for ( std::size_t i = 0u; i < workers; ++i )
+			m_workers.emplace_back( [this] { this->work(); } );
+	}
+	~c_thread_pool()
+	{
+		{
+			std::scoped_lock lock{ m_mutex };
+
+			m_stop = true;
+		}
+
+		m_cv.notify_all();
+
+		for ( auto& worker : m_workers )
+			worker.join();
+	}
+
+	c_thread_pool( const c_thread_pool& ) = delete;
+	c_thread_pool& operator=( const c_thread_pool& ) = delete;
+public:
+	template< typename F >
+	auto submit( F&& fn ) -> std::future< std::invoke_result_t< F > >
+	{
+		using result_t = std::invoke_result_t< F >;
+
+		auto task   = std::make_shared< std::packaged_task< result_t() > >( std::forward< F >( fn ) );
+		auto future = task->get_future();
+
+		{
+			std::scoped_lock lock{ m_mutex };
+
+			m_tasks.emplace_back( [task] { ( *task )(); } );
+		}
+
+		m_cv.notify_one();
+
+		return future;
+	}
+
+	auto size() const -> std::size_t
+	{
+		return m_workers.size();
+	}
+private:
+	void work()
+	{
+		while ( true )
+		{
+			std::function< void() > task{};
+
+			{
+				std::unique_lock lock{ m_mutex };
+
+				m_cv.wait( lock, [this] { return m_stop || !m_tasks.empty(); } );
+
+				if ( m_tasks.empty() )
+					return;
+
+				task = std::move( m_tasks.front() );
+
+				m_tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+private:
+	std::vector< std::thread >            m_workers;
+	std::deque< std::function< void() > > m_tasks;
+
+	std::mutex                            m_mutex;
+	std::condition_variable               m_cv;
+	bool                                  m_stop;
+};
+
+/**
+ * @brief pool of the index reads, started once and shared by every archive of the run
+ * @note its tasks must not wait on it
+ */
+inline auto shared_thread_pool() -> c_thread_pool&
+{
+	static c_thread_pool pool{};
+
+	return pool;
+}
+
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef THROTTLE_HPP
+#define THROTTLE_HPP
+
+#pragma once
+
+namespace rez
+{
+
+/**
+ * @brief token bucket, callers take tokens and sleep off any shortfall
+ *
+ * the tokens may go negative: a caller reserves what it takes and sleeps until the bucket
+ * would have refilled, so concurrent callers queue up behind each other at the set rate
+ */
+class c_token_bucket
+{
+public:
+	/**
+	 * @param rate tokens per second, 0 is unlimited
+	 */
+	void set_rate( const std::uint64_t rate );
+	auto rate() const -> std::uint64_t;
+
+	void acquire( const std::uint64_t amount );
+
+	auto throttled_seconds() const -> double
+	{
+		return static_cast< double >( m_throttled.load( std::memory_order_relaxed ) ) / 1e9;
+	}
+private:
+	using clock_t = std::chrono::steady_clock;
+
+	void refill( const clock_t::time_point now );
+private:
+	mutable std::mutex           m_mutex{};
+
+	std::uint64_t                m_rate{};
+	double                       m_tokens{};
+	clock_t::time_point          m_last{ clock_t::now() };
+
+	std::atomic< std::uint64_t > m_throttled{}; // ns slept, summed over the threads
+};
+
+struct throttle_limits_t
+{
+	// per second, 0 is unlimited
+	std::uint64_t m_read{};
+	std::uint64_t m_write{};
+	std::uint64_t m_creates{};
+};
+
+struct throttle_stats_t
+{
+	double m_read_seconds{};
+	double m_write_seconds{};
+	double m_create_seconds{};
+};
+
+/**
+ * @brief read/write bandwidth and file creation limits of the extraction
+ *
+ * the limits can change while the extraction runs: the control file is read again once it
+ * changes (checked every second, lines "max-read SIZE", "max-write SIZE", "max-creates N"),
+ * toggle() lifts and restores every limit (Ctrl+Break)
+ */
+class c_throttle
+{
+public:
+	void set_limits( const throttle_limits_t& limits );
+	auto limits() const -> throttle_limits_t;
+
+	void set_control_file( const std::filesystem::path& path );
+
+	/**
+	 * @brief wait for the budget of an operation, call before doing it
+	 */
+	void read( const std::uint64_t bytes );
+	void write( const std::uint64_t bytes );
+	void create();
+
+	/**
+	 * @return true when the limits are lifted
+	 */
+	auto toggle() -> bool;
+
+	/**
+	 * @brief any limit or a control file
+	 */
+	auto active() const -> bool;
+
+	auto stats() const -> throttle_stats_t;
+private:
+	void poll();
+private:
+	c_token_bucket                  m_read{};
+	c_token_bucket                  m_write{};
+	c_token_bucket                  m_create{};
+
+	std::atomic< bool >             m_suspended{};
+
+	mutable std::mutex              m_control_mutex{};
+	std::filesystem::path           m_control{};
+	std::filesystem::file_time_type m_control_time{};
+	std::atomic< std::int64_t >     m_next_poll{}; // steady clock ns
+};
+
+/**
+ * @brief shared by every read/write path of the extraction
+ */
+inline c_throttle g_throttle{};
+
+}
+
+#endif
@@ -56,8 +56,67 @@ inline auto log(
     std::cout << std::format(format, std::forward<args_t>(args)...);
 }
 
+// unaligned little endian load
+template <typename T>
+inline auto load_le(const char* data) -> T
+{
+    static_assert(std::is_integral_v<T>);
+
+    using unsigned_t = std::make_unsigned_t<T>;
+
+    unsigned_t value{};
+
+    for (std::size_t i = 0; i < sizeof(T); ++i)
+        value |= static_cast<unsigned_t>(static_cast<unsigned_t>(static_cast<unsigned char>(data[i])) << (8u * i));
+
+    return static_cast<T>(value);
+}
+
+// unaligned little endian store
+template <typename T>
+inline auto store_le(char* data, const T value) -> void
+{
+    static_assert(std::is_integral_v<T>);
+
+    using unsigned_t = std::make_unsigned_t<T>;
+
+    for (std::size_t i = 0; i < sizeof(T); ++i)
+        data[i] = static_cast<char>(static_cast<unsigned char>(static_cast<unsigned_t>(value) >> (8u * i)));
+}
+
+// lithtech resolves resource names without case
+inline auto to_lower(std::string value) -> std::string
+{
+    std::transform(value.begin(), value.end(), value.begin(), [](const char ch)
+    {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    });
+
+    return value;
+}
+
+// 64-bit FNV-1a, chain calls through seed
+inline auto fnv1a(const void* data, const std::size_t size, std::uint64_t seed = 0xCBF29CE484222325ull) -> std::uint64_t
+{
+    const auto bytes = static_cast<const unsigned char*>(data);
+
+    for (std::size_t i = 0u; i < size; ++i)
+    {
+        seed ^= bytes[i];
+        seed *= 0x100000001B3ull;
+    }
+
+    return seed;
+}
+
+// false when running from the command line, nothing waits for input
+inline bool g_interactive = true;
+
 inline auto pause() -> void
 {
+    if (!g_interactive)
+        return;
+
     log("Press the enter key to continue . . .");
 
     std::cin.clear();
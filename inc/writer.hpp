@@ -0,0 +1,208 @@
+#ifndef WRITER_HPP
+#define WRITER_HPP
+
+#pragma once
+
+namespace rez
+{
+
+/**
+ * @brief output file written through its handle, all zero blocks can be left as holes
+ */
+class c_writer
+{
+public:
+	//
+	// NTFS allocates sparse files in 64K units, a smaller hole wouldn't free anything
+	//
+	static constexpr std::size_t SPARSE_BLOCK = 0x10000u;
+public:
+	/**
+	 * @param sparse mark the file sparse and skip the zero blocks, ignored when the file system can't (FAT/exFAT)
+	 */
+	c_writer(
+		const std::filesystem::path& path,
+		const bool sparse = false
+	) :
+		m_path{ path },
+		m_file{ INVALID_HANDLE_VALUE },
+		m_pos{ 0u },
+		m_end{ 0u },
+		m_skipped{ 0u },
+		m_zero_run{ 0u },
+		m_sparse{ false }
+	{
+		m_file = ::CreateFileW(
+			path.wstring().data(),
+			GENERIC_WRITE,
+			0u,
+			nullptr,
+			CREATE_ALWAYS,
+			FILE_ATTRIBUTE_NORMAL,
+			nullptr
+		);
+
+		if ( m_file == INVALID_HANDLE_VALUE )
+			REZ_THROW( " - CreateFile: {:s}: {:s}", path.string(), std::system_category().message( ::GetLastError() ) );
+
+		if ( sparse )
+		{
+			DWORD bytes = 0u;
+
+			m_sparse = ::DeviceIoControl( m_file, FSCTL_SET_SPARSE, nullptr, 0u, nullptr, 0u, &bytes, nullptr ) != FALSE;
+		}
+	}
+	~c_writer()
+	{
+		if ( m_file != INVALID_HANDLE_VALUE )
+			::CloseHandle( m_file );
+	}
+
+	c_writer( const c_writer& ) = delete;
+	c_writer& operator=( const c_writer& ) = delete;
+public:
+	/**
+	 * @brief append data
+	 */
+	void write( const char* data, const std::size_t size )
+	{
+		if ( !m_sparse )
+		{
+			this->write_at( m_pos, data, size );
+
+			m_pos += size;
+
+			return;
+		}
+
+		//
+		// blocks follow the file offset so a hole always covers whole allocation units,
+		// consecutive data blocks still go out in a single write
+		//
+		// a block may span several calls (a chunk size below 64K): its zeros are held back
+		// until it is complete or data shows up, the held back bytes read as zeros either way
+		//
+		std::size_t pending = 0u;
+		std::size_t done    = 0u;
+
+		while ( done < size )
+		{
+			const auto offset = static_cast< std::size_t >( ( m_pos + done ) % SPARSE_BLOCK );
+			const auto step   = std::min< std::size_t >( size - done, SPARSE_BLOCK - offset );
+
+			if ( offset == 0u )
+				m_zero_run = 0u;
+
+			if ( m_zero_run == offset && is_zero( data + done, step ) )
+			{
+				this->write_at( m_pos + pending, data + pending, done - pending );
+
+				m_zero_run += step;
+				pending     = done + step;
+
+				if ( m_zero_run == SPARSE_BLOCK )
+					m_skipped += SPARSE_BLOCK;
+			}
+			else
+			{
+				// data in the block, the rest of it is written
+				m_zero_run = SPARSE_BLOCK + 1u;
+			}
+
+			done += step;
+		}
+
+		this->write_at( m_pos + pending, data + pending, size - pending );
+
+		m_pos += size;
+	}
+
+	/**
+	 * @brief set the final size, a trailing hole is never written so the file is extended here
+	 */
+	void finish()
+	{
+		if ( m_end == m_pos )
+			return;
+
+		LARGE_INTEGER pos{};
+
+		pos.QuadPart = static_cast< LONGLONG >( m_pos );
+
+		if ( !::SetFilePointerEx( m_file, pos, nullptr, FILE_BEGIN ) || !::SetEndOfFile( m_file ) )
+			REZ_THROW( " - SetEndOfFile: {:s}: {:s}", m_path.string(), std::system_category().message( ::GetLastError() ) );
+
+		m_end = m_pos;
+	}
+
+	auto size() const -> std::uint64_t { return m_pos; }
+
+	/**
+	 * @brief bytes left as holes
+	 */
+	auto skipped() const -> std::uint64_t { return m_skipped; }
+
+	/**
+	 * @brief 64 bytes per step, stops at the first non zero byte so data blocks cost next to nothing
+	 */
+	static auto is_zero( const char* data, const std::size_t size ) -> bool
+	{
+		const auto zero = _mm_setzero_si128();
+
+		std::size_t i = 0u;
+
+		for ( ; i + 64u <= size; i += 64u )
+		{
+			const auto v0 = _mm_loadu_si128( reinterpret_cast< const __m128i* >( data + i ) );
+			const auto v1 = _mm_loadu_si128( reinterpret_cast< const __m128i* >( data + i + 16u ) );
+			const auto v2 = _mm_loadu_si128( reinterpret_cast< const __m128i* >( data + i + 32u ) );
+			const auto v3 = _mm_loadu_si128( reinterpret_cast< const __m128i* >( data + i + 48u ) );
+
+			const auto v = _mm_or_si128( _mm_or_si128( v0, v1 ), _mm_or_si128( v2, v3 ) );
+
+			if ( _mm_movemask_epi8( _mm_cmpeq_epi8( v, zero ) ) != 0xFFFF )
+				return false;
+		}
+
+		for ( ; i < size; ++i )
+		{
+			if ( data[ i ] != '\0' )
+				return false;
+		}
+
+		return true;
+	}
+private:
+	void write_at( const std::uint64_t pos, const char* data, const std::size_t size )
+	{
+		if ( size == 0u )
+			return;
+
+		OVERLAPPED overlapped{};
+
+		overlapped.Offset     = static_cast< DWORD >( pos );
+		overlapped.OffsetHigh = static_cast< DWORD >( pos >> 32u );
+
+		DWORD written = 0u;
+
+		if ( !::WriteFile( m_file, data, static_cast< DWORD >( size ), &written, &overlapped ) || written != size )
+			REZ_THROW( " - WriteFile: {:s}: {:s}", m_path.string(), std::system_category().message( ::GetLastError() ) );
+
+		m_end = std::max< std::uint64_t >( m_end, pos + size );
+	}
+private:
+	std::filesystem::path m_path;
+
+	HANDLE                m_file;
+
+	std::uint64_t         m_pos;
+	std::uint64_t         m_end;
+	std::uint64_t         m_skipped;
+	std::size_t           m_zero_run; // zero bytes held back from the start of the current block
+
+	bool                  m_sparse;
+};
+
+}
+
+#endif
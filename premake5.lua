@@ -30,6 +30,12 @@ project "RezExtract"
         "inc"
     }
 
+    links
+    {
+        "Cabinet",
+        "Ws2_32"
+    }
+
     symbols "On"
     flags { "FatalWarnings", "MultiProcessorCompile" }
     warnings "High"
@@ -0,0 +1,230 @@
+#include "pch.hpp"
+#include "async.hpp"
+
+#include "buffer_pool.hpp"
+#include "io_tuning.hpp"
+#include "rez.hpp"
+#include "writer.hpp"
+
+namespace rez
+{
+
+struct async_state_t
+{
+	std::mutex                 m_mutex{};
+	progress_t                 m_progress{};
+	std::atomic< std::size_t > m_failed{};
+};
+
+/**
+ * @brief a failed resource doesn't stop the others, only a cancellation does
+ */
+static auto extract_guarded(
+	std::shared_ptr< c_async_archive > archive,
+	const std::size_t dir,
+	const std::size_t res,
+	std::filesystem::path output,
+	const int priority,
+	async_options_t options,
+	std::shared_ptr< async_state_t > state
+) -> c_task< std::uint64_t >
+{
+	const auto& resource = archive->rez().index().m_directories[ dir ].m_resource[ res ];
+
+	const auto path = archive->rez().directory_path( dir ) / c_rez_file::resource_filename( resource );
+
+	std::uint64_t bytes = 0u;
+
+	try
+	{
+		bytes = co_await extract_resource_async( archive, dir, res, output, priority, options );
+	}
+	catch ( const c_cancelled& )
+	{
+		throw;
+	}
+	catch ( const std::exception& e )
+	{
+		log( "  - {:s}: {:s}\n", path.string(), e.what() );
+
+		++state->m_failed;
+
+		co_return 0u;
+	}
+
+	std::scoped_lock lock{ state->m_mutex };
+
+	auto& progress = state->m_progress;
+
+	progress.m_resources += 1u;
+	progress.m_bytes     += bytes;
+	progress.m_path       = path;
+
+	if ( options.m_progress )
+		options.m_progress( progress );
+
+	co_return bytes;
+}
+
+/**
+ * @brief extract_async without the error handling of the archive
+ */
+static auto extract_archive( std::filesystem::path file_path, std::filesystem::path save_path, async_options_t options ) -> c_task< async_result_t >
+{
+	if ( !options.m_executor )
+		REZ_THROW( " - No executor" );
+
+	auto archive = co_await open_async( file_path, options );
+
+	co_await load_index_async( archive, options );
+
+	throw_if_cancelled( options.m_stop );
+
+	const auto& rez         = archive->rez();
+	const auto& directories = rez.index().m_directories;
+
+	auto state = std::make_shared< async_state_t >();
+
+	std::vector< c_task< std::uint64_t > > tasks{};
+
+	for ( std::size_t d = 0u; d < directories.size(); ++d )
+	{
+		const auto dir_path = rez.directory_path( d );
+
+		// created up front, the resource tasks only write files
+		std::filesystem::create_directories( save_path / dir_path );
+
+		for ( std::size_t r = 0u; r < directories[ d ].m_resource.size(); ++r )
+		{
+			const auto& res = directories[ d ].m_resource[ r ];
+
+			const auto priority = options.m_resource_priority ?
+				options.m_resource_priority( dir_path / c_rez_file::resource_filename( res ) ) :
+				options.m_priority;
+
+			state->m_progress.m_total_resources += 1u;
+			state->m_progress.m_total_bytes     += res.m_header.m_size;
+
+			tasks.emplace_back( extract_guarded( archive, d, r, save_path, priority, options, state ) );
+		}
+	}
+
+	const auto sizes = co_await when_all( std::move( tasks ) );
+
+	async_result_t result{};
+
+	result.m_resources = sizes.size() - state->m_failed;
+	result.m_failed    = state->m_failed;
+
+	for ( const auto size : sizes )
+		result.m_bytes += size;
+
+	co_return result;
+}
+
+}
+
+auto rez::open_async( std::filesystem::path path, async_options_t options ) -> c_task< std::shared_ptr< c_async_archive > >
+{
+	co_await schedule( *options.m_executor, options.m_priority );
+
+	throw_if_cancelled( options.m_stop );
+
+	auto archive = std::make_shared< c_async_archive >( path );
+
+	archive->rez().load();
+
+	co_return archive;
+}
+
+auto rez::load_index_async( std::shared_ptr< c_async_archive > archive, async_options_t options ) -> c_task<>
+{
+	co_await schedule( *options.m_executor, options.m_priority );
+
+	throw_if_cancelled( options.m_stop );
+
+	archive->rez().read_index();
+}
+
+auto rez::extract_resource_async(
+	std::shared_ptr< c_async_archive > archive,
+	const std::size_t dir,
+	const std::size_t res,
+	std::filesystem::path output,
+	const int priority,
+	async_options_t options
+) -> c_task< std::uint64_t >
+{
+	co_await schedule( *options.m_executor, priority );
+
+	throw_if_cancelled( options.m_stop );
+
+	auto& rez = archive->rez();
+
+	const auto& resource = rez.index().m_directories.at( dir ).m_resource.at( res );
+
+	const auto file = output / rez.directory_path( dir ) / c_rez_file::resource_filename( resource );
+
+	const std::uint32_t pos  = resource.m_header.m_pos;
+	const std::uint32_t size = resource.m_header.m_size;
+
+	try
+	{
+		c_writer out{ file, g_sparse };
+
+		const auto buffer = shared_buffer_pool().acquire( std::min< std::size_t >( size, g_io_tuning.m_chunk_size ) );
+		const auto data   = buffer.data();
+
+		const auto step_data_size = static_cast< std::uint32_t >( std::min( buffer.size(), g_io_tuning.m_chunk_size ) );
+
+		for ( std::uint32_t step = 0u; step < size; )
+		{
+			// checked per chunk, a large resource stops quickly too
+			throw_if_cancelled( options.m_stop );
+
+			const std::uint32_t step_size = std::min( size - step, step_data_size );
+
+			archive->read_at( pos + step, data, step_size );
+
+			if ( g_dtx_to_lithtech && step == 0u )
+				c_rez_file::convert_dtx( resource, data, step_size );
+
+			out.write( data, step_size );
+
+			step += step_size;
+		}
+
+		out.finish();
+	}
+	catch ( ... )
+	{
+		// no partial file, whether cancelled or failed
+		std::error_code ec{};
+		std::filesystem::remove( file, ec );
+
+		throw;
+	}
+
+	co_return size;
+}
+
+auto rez::extract_async( std::filesystem::path file_path, std::filesystem::path save_path, async_options_t options ) -> c_task< async_result_t >
+{
+	try
+	{
+		co_return co_await extract_archive( file_path, save_path, options );
+	}
+	catch ( const c_cancelled& )
+	{
+		throw;
+	}
+	catch ( const std::exception& e )
+	{
+		// the other archives go on
+		async_result_t result{};
+
+		result.m_error = e.what();
+
+		co_return result;
+	}
+}
@@ -1,17 +1,39 @@
 #include "pch.hpp"
 #include "block.hpp"
 
-void rez::rez_t::read(
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+#include "throttle.hpp"
+
+namespace rez
+{
+
+/**
+ * @brief recursive read of a block, ancestors holds the blocks (pos and size) on the way down from the root
+ */
+static void read_block(
+	std::vector< directory_t >& directories,
 	c_reader& reader,
 	const std::uint32_t pos,
-	const std::uint32_t size
+	const std::uint32_t size,
+	std::vector< std::uint64_t >& ancestors
 )
 {
 	if ( size == 0u )
 		REZ_THROW( " - Invalid block size (Expected: >1 | Current: 0" );
 
+	//
+	// a block shared by several directories is read for each, a block inside itself never ends
+	//
+	const auto key = ( std::uint64_t{ pos } << 32u ) | size;
+
+	if ( std::find( ancestors.begin(), ancestors.end(), key ) != ancestors.end() )
+		REZ_THROW( " - Directory block loop (Pos: {:d})", pos );
+
 	std::vector< char > block_data( size, '\0' );
 
+	g_throttle.read( size );
+
 	reader.seek( pos );
 	reader.read( block_data[ 0u ], block_data.size() );
 
@@ -28,14 +50,16 @@ void rez::rez_t::read(
 	//
 	// has another directory?
 	//
-	if ( m_directories.size() )
+	if ( directories.size() )
 	{
 		//
 		// save last directory index (owner directory)
 		//
-		directory_owner = m_directories.size() - 1u;
+		directory_owner = directories.size() - 1u;
 	}
 
+	ancestors.emplace_back( key );
+
 	//
 	// go through all directories/files
 	//
@@ -54,10 +78,13 @@ void rez::rez_t::read(
 		{
 		case file_directory_entry_type_resource:
 		{
-			if ( m_directories.empty() )
+			if ( directory_owner == std::numeric_limits<std::size_t>::max() )
 				REZ_THROW( " - Can't get files in empty directory" );
 
-			auto& dir   = m_directories.back();
+			//
+			// the directory owning the block, not the last one read (a resource may follow a subdirectory)
+			//
+			auto& dir   = directories[ directory_owner ];
 			auto& res   = dir.m_resource;
 
 			auto& block = res.emplace_back( block_resource_t{ header } );
@@ -71,13 +98,16 @@ void rez::rez_t::read(
 		}
 		case file_directory_entry_type_directory:
 		{
-			auto& dir = m_directories.emplace_back( directory_t{ header } );
+			auto& dir = directories.emplace_back( directory_t{ header } );
 
 			dir.m_name        = itr.read_string();
 			dir.m_owner_index = directory_owner;
 
 			if ( dir.m_header.m_size )
 			{
+				// dir is gone once the recursion adds directories
+				const auto child = dir.m_header;
+
 				/**
 				 * save reader pos
 				 */
@@ -86,7 +116,7 @@ void rez::rez_t::read(
 				/**
 				 * recursive read
 				 */
-				this->read( reader, dir.m_header.m_pos, dir.m_header.m_size );
+				read_block( directories, reader, child.m_pos, child.m_size, ancestors );
 
 				/**
 				 * restore reader pos
@@ -98,6 +128,203 @@ void rez::rez_t::read(
 		}
 		}
 	}
+
+	ancestors.pop_back();
+}
+
+}
+
+void rez::rez_t::read(
+	c_reader& reader,
+	const std::uint32_t pos,
+	const std::uint32_t size
+)
+{
+	std::vector< std::uint64_t > ancestors{};
+
+	read_block( m_directories, reader, pos, size, ancestors );
+}
+
+namespace rez
+{
+
+/**
+ * @brief entries of a single directory block, parsed on its own
+ */
+struct parsed_block_t
+{
+	std::uint32_t                   m_pos{};
+	std::vector< block_resource_t > m_resources{};
+	std::vector< directory_t >      m_directories{};
+	std::vector< std::size_t >      m_children{}; // block per directory, npos when the directory is empty
+
+	std::size_t                     m_uses{};     // directories pointing at the block, the last one takes its entries
+	bool                            m_merging{};  // on the way down from the root, i.e. a loop when met again
+};
+
+static auto parse_block( const c_mapped_file& file, const std::uint32_t pos, const std::uint32_t size ) -> parsed_block_t
+{
+	if ( size == 0u )
+		REZ_THROW( " - Invalid block size (Expected: >1 | Current: 0" );
+
+	const auto view = file.view( pos, size );
+
+	// the copy faults the pages in, the read of the block
+	g_throttle.read( size );
+
+	std::vector< char > block_data( view.begin(), view.end() );
+
+	//
+	// own cursor per task
+	//
+	block_iterator_t itr = { block_data.begin(), block_data.end() };
+
+	parsed_block_t block{ pos };
+
+	while ( itr.current() < itr.end() )
+	{
+		auto header = block_header_t{ itr.read() };
+
+		if ( header.m_type != file_directory_entry_type_resource && header.m_type != file_directory_entry_type_directory )
+			REZ_THROW( " - Invalid block type" );
+
+		header.m_pos  = itr.read();
+		header.m_size = itr.read();
+		header.m_time = itr.read();
+
+		switch ( header.m_type )
+		{
+		case file_directory_entry_type_resource:
+		{
+			block.m_resources.emplace_back( block_resource_t{ header } ).read_resource( itr );
+
+			break;
+		}
+		case file_directory_entry_type_directory:
+		{
+			block.m_directories.emplace_back( directory_t{ header } ).m_name = itr.read_string();
+
+			break;
+		}
+		}
+	}
+
+	return block;
+}
+
+static void merge_block(
+	std::vector< directory_t >& directories,
+	std::vector< parsed_block_t >& blocks,
+	const std::size_t id,
+	const std::size_t owner
+)
+{
+	auto& block = blocks[ id ];
+
+	if ( block.m_merging )
+		REZ_THROW( " - Directory block loop (Pos: {:d})", block.m_pos );
+
+	block.m_merging = true;
+
+	// a shared block is copied into every directory but the last
+	const bool last = --block.m_uses == 0u;
+
+	if ( !block.m_resources.empty() )
+	{
+		if ( owner == std::numeric_limits<std::size_t>::max() )
+			REZ_THROW( " - Can't get files in empty directory" );
+
+		auto& res = directories[ owner ].m_resource;
+
+		if ( last )
+			std::move( block.m_resources.begin(), block.m_resources.end(), std::back_inserter( res ) );
+		else
+			res.insert( res.end(), block.m_resources.begin(), block.m_resources.end() );
+	}
+
+	for ( std::size_t i = 0u; i < block.m_directories.size(); ++i )
+	{
+		const auto index = directories.size();
+
+		if ( last )
+			directories.emplace_back( std::move( block.m_directories[ i ] ) );
+		else
+			directories.emplace_back( block.m_directories[ i ] );
+
+		directories[ index ].m_owner_index = owner;
+
+		if ( block.m_children[ i ] != std::numeric_limits<std::size_t>::max() )
+			merge_block( directories, blocks, block.m_children[ i ], index );
+	}
+
+	block.m_merging = false;
+}
+
+}
+
+void rez::rez_t::read_parallel(
+	const c_mapped_file& file,
+	const std::uint32_t pos,
+	const std::uint32_t size,
+	c_thread_pool& pool
+)
+{
+	std::vector< std::future< parsed_block_t > > pending{};
+	std::vector< parsed_block_t >                blocks{};
+	std::vector< std::size_t >                   uses{ 1u };
+
+	// a block shared by several directories is parsed once (keyed by pos and size), a loop is caught by merge_block, like a read of its own
+	std::unordered_map< std::uint64_t, std::size_t > visited{};
+
+	pending.emplace_back( pool.submit( [&file, pos, size] { return parse_block( file, pos, size ); } ) );
+
+	visited.emplace( ( std::uint64_t{ pos } << 32u ) | size, 0u );
+
+	//
+	// collect in submission order, the children are queued as soon as their parent is parsed
+	//
+	for ( std::size_t id = 0u; id < pending.size(); ++id )
+	{
+		auto block = pending[ id ].get();
+
+		for ( const auto& dir : block.m_directories )
+		{
+			if ( dir.m_header.m_size == 0u )
+			{
+				block.m_children.emplace_back( std::numeric_limits<std::size_t>::max() );
+
+				continue;
+			}
+
+			const auto [it, added] = visited.emplace( ( std::uint64_t{ dir.m_header.m_pos } << 32u ) | dir.m_header.m_size, pending.size() );
+
+			block.m_children.emplace_back( it->second );
+
+			if ( !added )
+			{
+				++uses[ it->second ];
+
+				continue;
+			}
+
+			uses.emplace_back( 1u );
+
+			pending.emplace_back( pool.submit( [&file, header = dir.m_header]
+			{
+				return parse_block( file, header.m_pos, header.m_size );
+			} ) );
+		}
+
+		blocks.emplace_back( std::move( block ) );
+	}
+
+	for ( std::size_t id = 0u; id < blocks.size(); ++id )
+		blocks[ id ].m_uses = uses[ id ];
+
+	//
+	// same order and owners as the recursive read
+	//
+	merge_block( m_directories, blocks, 0u, m_directories.empty() ? std::numeric_limits<std::size_t>::max() : m_directories.size() - 1u );
 }
 
 auto rez::block_resource_t::read_resource( block_iterator_t& itr ) -> block_resource_t&
@@ -114,12 +341,247 @@ auto rez::block_resource_t::read_resource( block_iterator_t& itr ) -> block_reso
 	m_name        = itr.read_string();
 	m_description = itr.read_string();
 
-	if ( m_num_keys )
+	//
+	// kept so the entry can be written back (compaction), keys past the block are skipped
+	//
+	m_keys.clear();
+
+	for ( std::uint32_t i = 0u; i < m_num_keys; ++i )
 	{
-		itr.advance(
-			sizeof( m_num_keys ) * m_num_keys
-		);
+		if ( itr.current() + sizeof( std::uint32_t ) > itr.end() + 1 )
+		{
+			// to the end of the block, a damaged count would wrap the cursor
+			itr.advance( static_cast< std::uint32_t >( itr.end() + 1 - itr.current() ) );
+
+			break;
+		}
+
+		m_keys.emplace_back( itr.read() );
 	}
 
 	return *this;
 }
+
+namespace rez
+{
+
+/**
+ * @brief case insensitive compare, lithtech resolves names without case
+ */
+static auto compare_nocase( const std::string_view lhs, const std::string_view rhs ) -> int
+{
+	const auto size = std::min( lhs.size(), rhs.size() );
+
+	for ( std::size_t i = 0u; i < size; ++i )
+	{
+		const auto a = std::tolower( static_cast< unsigned char >( lhs[ i ] ) );
+		const auto b = std::tolower( static_cast< unsigned char >( rhs[ i ] ) );
+
+		if ( a != b )
+			return a < b ? -1 : 1;
+	}
+
+	if ( lhs.size() == rhs.size() )
+		return 0;
+
+	return lhs.size() < rhs.size() ? -1 : 1;
+}
+
+/**
+ * @brief compare the stored (reversed) extension with a regular one
+ */
+static auto compare_ext_nocase( const std::string_view stored, const std::string_view ext ) -> int
+{
+	std::string value{ stored };
+
+	std::reverse( value.begin(), value.end() );
+
+	return compare_nocase( value, ext );
+}
+
+/**
+ * @brief order of two entries of the same type in a sorted block, by name then (resources) extension
+ */
+static auto compare_entries( const directory_block_t::entry_t& lhs, const directory_block_t::entry_t& rhs ) -> int
+{
+	if ( const auto result = compare_nocase( lhs.m_name, rhs.m_name ); result != 0 || lhs.m_type != file_directory_entry_type_resource )
+		return result;
+
+	std::string ext{ rhs.m_ext };
+
+	std::reverse( ext.begin(), ext.end() );
+
+	return compare_ext_nocase( lhs.m_ext, ext );
+}
+
+}
+
+void rez::directory_block_t::read(
+	c_reader& reader,
+	const std::uint32_t pos,
+	const std::uint32_t size
+)
+{
+	m_entries.clear();
+
+	for ( auto& entries : m_types )
+		entries.clear();
+
+	if ( size == 0u )
+		REZ_THROW( " - Invalid block size (Expected: >1 | Current: 0" );
+
+	m_data.assign( size, '\0' );
+
+	reader.seek( pos );
+	reader.read( m_data[ 0u ], m_data.size() );
+
+	//
+	// string inside the block, never read past the end
+	//
+	auto string_at = [this] ( const std::size_t offset ) -> std::string_view
+	{
+		if ( offset >= m_data.size() )
+			REZ_THROW( " - Invalid block entry (Offset: {:d} | Size: {:d})", offset, m_data.size() );
+
+		const auto begin = m_data.data() + offset;
+		const auto end   = std::find( begin, m_data.data() + m_data.size(), '\0' );
+
+		if ( end == m_data.data() + m_data.size() )
+			REZ_THROW( " - Unterminated block string (Offset: {:d})", offset );
+
+		return { begin, static_cast< std::size_t >( end - begin ) };
+	};
+
+	auto u32_at = [this] ( const std::size_t offset ) -> std::uint32_t
+	{
+		if ( offset + sizeof( std::uint32_t ) > m_data.size() )
+			REZ_THROW( " - Invalid block entry (Offset: {:d} | Size: {:d})", offset, m_data.size() );
+
+		return load_le< std::uint32_t >( m_data.data() + offset );
+	};
+
+	//
+	// only locate the entries, nothing is copied
+	//
+	std::size_t offset = 0u;
+
+	while ( offset + sizeof( block_header_t ) <= m_data.size() )
+	{
+		entry_t entry{ static_cast< std::uint32_t >( offset ), u32_at( offset + entry_layout_t::TYPE ) };
+
+		switch ( entry.m_type )
+		{
+		case file_directory_entry_type_resource:
+		{
+			const auto ext      = offset + entry_layout_t::RES_EXT;
+			const auto num_keys = u32_at( offset + entry_layout_t::RES_KEYS );
+
+			entry.m_ext  = { m_data.data() + ext, static_cast< std::size_t >( std::find( m_data.data() + ext, m_data.data() + ext + 4u, '\0' ) - ( m_data.data() + ext ) ) };
+			entry.m_name = string_at( offset + entry_layout_t::RES_NAME );
+
+			offset += entry_layout_t::RES_NAME + entry.m_name.size() + 1u;
+			offset += string_at( offset ).size() + 1u;
+
+			// a damaged count would wrap the offset (32 bit size_t) and read the block again
+			if ( num_keys > ( m_data.size() - offset ) / sizeof( std::uint32_t ) )
+				REZ_THROW( " - Invalid key count (Keys: {:d} | Offset: {:d} | Size: {:d})", num_keys, offset, m_data.size() );
+
+			offset += sizeof( std::uint32_t ) * num_keys;
+
+			break;
+		}
+		case file_directory_entry_type_directory:
+		{
+			entry.m_name = string_at( offset + entry_layout_t::DIR_NAME );
+
+			offset += entry_layout_t::DIR_NAME + entry.m_name.size() + 1u;
+
+			break;
+		}
+		default:
+			REZ_THROW( " - Invalid block type" );
+		}
+
+		m_types[ entry.m_type ].emplace_back( static_cast< std::uint32_t >( m_entries.size() ) );
+		m_entries.emplace_back( entry );
+	}
+
+	//
+	// directories and resources are sorted by name separately, checked once here so a lookup can trust it
+	//
+	for ( std::size_t type = 0u; type < m_types.size(); ++type )
+	{
+		const auto& entries = m_types[ type ];
+
+		m_ordered[ type ] = std::adjacent_find( entries.begin(), entries.end(), [this] ( const std::uint32_t lhs, const std::uint32_t rhs )
+		{
+			return compare_entries( m_entries[ lhs ], m_entries[ rhs ] ) > 0;
+		} ) == entries.end();
+	}
+}
+
+auto rez::directory_block_t::find(
+	const std::uint32_t type,
+	const std::string_view name,
+	const std::string_view ext,
+	const bool sorted
+) const -> const entry_t*
+{
+	auto compare = [&] ( const entry_t& entry ) -> int
+	{
+		if ( const auto result = compare_nocase( entry.m_name, name ); result != 0 )
+			return result;
+
+		return type == file_directory_entry_type_resource ? compare_ext_nocase( entry.m_ext, ext ) : 0;
+	};
+
+	if ( type >= m_types.size() )
+		return nullptr;
+
+	const auto& entries = m_types[ type ];
+
+	//
+	// the header flag is only a hint, read() checked the order
+	//
+	if ( sorted && m_ordered[ type ] )
+	{
+		const auto it = std::lower_bound( entries.begin(), entries.end(), 0, [&] ( const std::uint32_t entry, int )
+		{
+			return compare( m_entries[ entry ] ) < 0;
+		} );
+
+		if ( it != entries.end() && compare( m_entries[ *it ] ) == 0 )
+			return &m_entries[ *it ];
+
+		return nullptr;
+	}
+
+	for ( const auto entry : entries )
+	{
+		if ( compare( m_entries[ entry ] ) == 0 )
+			return &m_entries[ entry ];
+	}
+
+	return nullptr;
+}
+
+auto rez::directory_block_t::header( const entry_t& entry ) const -> block_header_t
+{
+	return load_block_header( m_data.data() + entry.m_offset );
+}
+
+auto rez::directory_block_t::resource( const entry_t& entry ) const -> block_resource_t
+{
+	// the iterator only reads
+	auto& data = const_cast< std::vector< char >& >( m_data );
+
+	block_iterator_t itr = { data.begin(), data.end() };
+
+	itr.advance( entry.m_offset + static_cast< std::uint32_t >( sizeof( block_header_t ) ) );
+
+	auto res = block_resource_t{ this->header( entry ) };
+
+	res.read_resource( itr );
+
+	return res;
+}
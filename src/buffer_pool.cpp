@@ -0,0 +1,187 @@
+#include "pch.hpp"
+#include "buffer_pool.hpp"
+
+#include "rez.hpp"
+
+namespace rez
+{
+
+/**
+ * @brief large pages need SeLockMemoryPrivilege enabled in the process token
+ */
+static auto enable_lock_memory_privilege() -> bool
+{
+	HANDLE token = nullptr;
+
+	if ( !::OpenProcessToken( ::GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token ) )
+		return false;
+
+	TOKEN_PRIVILEGES privileges{};
+
+	privileges.PrivilegeCount             = 1u;
+	privileges.Privileges[ 0 ].Attributes = SE_PRIVILEGE_ENABLED;
+
+	bool result = ::LookupPrivilegeValueA( nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[ 0 ].Luid ) &&
+		::AdjustTokenPrivileges( token, FALSE, &privileges, 0u, nullptr, nullptr ) &&
+		::GetLastError() == ERROR_SUCCESS; // ERROR_NOT_ALL_ASSIGNED when the account lacks the right
+
+	::CloseHandle( token );
+
+	return result;
+}
+
+}
+
+rez::c_buffer_pool::c_buffer_pool( const std::uint64_t budget, const bool large_pages ) :
+	m_free{},
+	m_budget{ std::max< std::uint64_t >( budget, SIZE_CLASSES.back() ) },
+	m_large_page_size{ 0u },
+	m_stats{}
+{
+	if ( large_pages )
+	{
+		if ( enable_lock_memory_privilege() )
+			m_large_page_size = ::GetLargePageMinimum();
+
+		if ( !m_large_page_size )
+			log( " - Large pages unavailable (SeLockMemoryPrivilege), using regular pages\n" );
+	}
+
+	m_stats.m_large_pages = m_large_page_size != 0u;
+}
+
+rez::c_buffer_pool::~c_buffer_pool()
+{
+	for ( std::size_t i = 0u; i < m_free.size(); ++i )
+	{
+		for ( const auto data : m_free[ i ] )
+			this->free( data, SIZE_CLASSES[ i ] );
+	}
+}
+
+auto rez::c_buffer_pool::acquire( const std::size_t size ) -> c_buffer
+{
+	const auto index      = class_index( size );
+	const auto class_size = SIZE_CLASSES[ index ];
+
+	std::unique_lock lock{ m_mutex };
+
+	++m_stats.m_acquired;
+
+	while ( true )
+	{
+		auto& cached = m_free[ index ];
+
+		if ( !cached.empty() )
+		{
+			const auto data = cached.back();
+
+			cached.pop_back();
+
+			++m_stats.m_reused;
+
+			return { this, data, class_size };
+		}
+
+		//
+		// a single buffer is always allowed, otherwise a budget below the class size would never make progress
+		//
+		if ( m_stats.m_allocated + class_size <= m_budget || m_stats.m_allocated == 0u || this->trim( class_size ) )
+		{
+			m_stats.m_allocated += class_size;
+			m_stats.m_peak       = std::max( m_stats.m_peak, m_stats.m_allocated );
+
+			lock.unlock();
+
+			const auto data = this->allocate( class_size );
+
+			if ( !data )
+			{
+				lock.lock();
+
+				m_stats.m_allocated -= class_size;
+
+				REZ_THROW( " - Buffer pool: out of memory ({:d} bytes)", class_size );
+			}
+
+			return { this, data, class_size };
+		}
+
+		++m_stats.m_waits;
+
+		m_cv.wait( lock );
+	}
+}
+
+auto rez::c_buffer_pool::stats() const -> stats_t
+{
+	std::scoped_lock lock{ m_mutex };
+
+	return m_stats;
+}
+
+void rez::c_buffer_pool::release( char* data, const std::size_t size )
+{
+	{
+		std::scoped_lock lock{ m_mutex };
+
+		m_free[ class_index( size ) ].emplace_back( data );
+	}
+
+	m_cv.notify_all();
+}
+
+auto rez::c_buffer_pool::allocate( const std::size_t size ) -> char*
+{
+	//
+	// page aligned, usable with unbuffered i/o
+	//
+	if ( m_large_page_size && size >= m_large_page_size && size % m_large_page_size == 0u )
+	{
+		if ( const auto data = ::VirtualAlloc( nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE ) )
+			return static_cast< char* >( data );
+	}
+
+	return static_cast< char* >( ::VirtualAlloc( nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE ) );
+}
+
+void rez::c_buffer_pool::free( char* data, const std::size_t )
+{
+	::VirtualFree( data, 0u, MEM_RELEASE );
+}
+
+auto rez::c_buffer_pool::trim( const std::size_t size ) -> bool
+{
+	for ( std::size_t i = 0u; i < m_free.size() && m_stats.m_allocated + size > m_budget; ++i )
+	{
+		auto& cached = m_free[ i ];
+
+		while ( !cached.empty() && m_stats.m_allocated + size > m_budget )
+		{
+			this->free( cached.back(), SIZE_CLASSES[ i ] );
+
+			cached.pop_back();
+
+			m_stats.m_allocated -= SIZE_CLASSES[ i ];
+		}
+	}
+
+	return m_stats.m_allocated + size <= m_budget;
+}
+
+auto rez::c_buffer_pool::class_index( const std::size_t size ) -> std::size_t
+{
+	const auto it = std::lower_bound( SIZE_CLASSES.begin(), SIZE_CLASSES.end(), size );
+
+	if ( it == SIZE_CLASSES.end() )
+		return SIZE_CLASSES.size() - 1u;
+
+	return static_cast< std::size_t >( std::distance( SIZE_CLASSES.begin(), it ) );
+}
+
+auto rez::shared_buffer_pool() -> c_buffer_pool&
+{
+	static c_buffer_pool pool{ g_memory_budget, g_large_pages };
+
+	return pool;
+}
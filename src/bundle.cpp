@@ -0,0 +1,458 @@
+#include "pch.hpp"
+#include "bundle.hpp"
+
+#include "rez.hpp"
+#include "rez_file.hpp"
+#include "thread_pool.hpp"
+
+namespace rez
+{
+
+static constexpr std::array< char, 4u > BUNDLE_MAGIC   = { 'R', 'Z', 'B', '1' };
+static constexpr std::uint32_t          BUNDLE_VERSION = 1u;
+
+static_assert( sizeof( bundle_header_t ) == 40u );
+static_assert( sizeof( bundle_frame_t ) == 16u );
+static_assert( sizeof( bundle_entry_t ) == 24u );
+
+/**
+ * @brief map the compression level to the codecs of the windows compression api (fast -> strong)
+ */
+static auto bundle_algorithm( const std::uint32_t level ) -> DWORD
+{
+	if ( level <= 3u )
+		return COMPRESS_ALGORITHM_XPRESS;
+
+	if ( level <= 6u )
+		return COMPRESS_ALGORITHM_XPRESS_HUFF;
+
+	if ( level <= 9u )
+		return COMPRESS_ALGORITHM_MSZIP;
+
+	return COMPRESS_ALGORITHM_LZMS;
+}
+
+struct compressed_frame_t
+{
+	std::vector< char > m_data{};
+	std::uint32_t       m_flags{};
+};
+
+/**
+ * @brief compressor handles are not thread safe, one per worker
+ */
+struct compressor_t
+{
+	~compressor_t()
+	{
+		if ( m_handle )
+			::CloseCompressor( m_handle );
+	}
+
+	auto get( const DWORD algorithm ) -> COMPRESSOR_HANDLE
+	{
+		if ( m_handle && m_algorithm != algorithm )
+		{
+			::CloseCompressor( m_handle );
+
+			m_handle = nullptr;
+		}
+
+		if ( !m_handle )
+		{
+			if ( !::CreateCompressor( algorithm, nullptr, &m_handle ) )
+				REZ_THROW( " - CreateCompressor: {:s}", std::system_category().message( ::GetLastError() ) );
+
+			m_algorithm = algorithm;
+		}
+
+		return m_handle;
+	}
+
+	COMPRESSOR_HANDLE m_handle{};
+	DWORD             m_algorithm{};
+};
+
+static auto compress_frame( const DWORD algorithm, std::vector< char > raw ) -> compressed_frame_t
+{
+	thread_local compressor_t compressor{};
+
+	const auto handle = compressor.get( algorithm );
+
+	//
+	// query the required size
+	//
+	SIZE_T size = 0u;
+
+	if ( !::Compress( handle, raw.data(), raw.size(), nullptr, 0u, &size ) && ::GetLastError() != ERROR_INSUFFICIENT_BUFFER )
+		REZ_THROW( " - Compress: {:s}", std::system_category().message( ::GetLastError() ) );
+
+	compressed_frame_t frame{};
+
+	if ( size < raw.size() )
+	{
+		frame.m_data.resize( size );
+
+		if ( !::Compress( handle, raw.data(), raw.size(), frame.m_data.data(), frame.m_data.size(), &size ) )
+			REZ_THROW( " - Compress: {:s}", std::system_category().message( ::GetLastError() ) );
+
+		frame.m_data.resize( size );
+	}
+
+	//
+	// incompressible data is stored as is
+	//
+	if ( frame.m_data.empty() || frame.m_data.size() >= raw.size() )
+	{
+		frame.m_data  = std::move( raw );
+		frame.m_flags = bundle_frame_flags_stored;
+	}
+
+	return frame;
+}
+
+}
+
+void rez::write_bundle( c_rez_file& rez, const std::filesystem::path& output, const bundle_options_t& options )
+{
+	if ( options.m_frame_size == 0u )
+		REZ_THROW( " - Invalid frame size" );
+
+	// the archive is read while the bundle is written, and a failed bundle is removed
+	if ( std::error_code ec{}; std::filesystem::equivalent( output, rez.path(), ec ) )
+		REZ_THROW( " - Output is the archive: {:s}", output.string() );
+
+	rez.read_index();
+
+	const auto& directories = rez.index().m_directories;
+
+	//
+	// stream the resources in archive offset order
+	//
+	struct item_t
+	{
+		const block_resource_t* m_res;
+		std::string             m_path;
+	};
+
+	std::vector< item_t > items{};
+
+	for ( std::size_t d = 0u; d < directories.size(); ++d )
+	{
+		const auto dir_path = rez.directory_path( d );
+
+		for ( const auto& res : directories[ d ].m_resource )
+			items.emplace_back( item_t{ &res, ( dir_path / c_rez_file::resource_filename( res ) ).generic_string() } );
+	}
+
+	std::stable_sort( items.begin(), items.end(), [] ( const item_t& lhs, const item_t& rhs )
+	{
+		return lhs.m_res->m_header.m_pos < rhs.m_res->m_header.m_pos;
+	} );
+
+	const auto algorithm = bundle_algorithm( options.m_level );
+
+	//
+	// every frame in flight holds the raw and the compressed data
+	//
+	const auto in_flight = std::max< std::uint64_t >( options.m_memory_budget / ( 2ull * options.m_frame_size ), 1u );
+
+	c_thread_pool pool{ options.m_threads };
+
+	try
+	{
+		std::ofstream out{};
+		out.exceptions( std::ios::badbit | std::ios::failbit );
+		out.open( output, std::ios::binary );
+
+		bundle_header_t header{ BUNDLE_MAGIC, BUNDLE_VERSION, static_cast< std::uint32_t >( algorithm ), options.m_frame_size };
+
+		// written again once the index is known
+		out.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+
+		std::deque< std::future< compressed_frame_t > > pending{};
+		std::vector< bundle_frame_t >                   frames{};
+
+		std::uint64_t out_pos = sizeof( header );
+
+		//
+		// write the oldest frame, the output stays in stream order
+		//
+		auto write_frame = [&] () -> void
+		{
+			auto frame = pending.front().get();
+
+			pending.pop_front();
+
+			out.write( frame.m_data.data(), static_cast< std::streamsize >( frame.m_data.size() ) );
+
+			frames.emplace_back( bundle_frame_t{ out_pos, static_cast< std::uint32_t >( frame.m_data.size() ), frame.m_flags } );
+
+			out_pos += frame.m_data.size();
+		};
+
+		std::vector< char > current{};
+		current.reserve( options.m_frame_size );
+
+		auto submit_frame = [&] () -> void
+		{
+			if ( current.empty() )
+				return;
+
+			while ( pending.size() >= in_flight )
+				write_frame();
+
+			pending.emplace_back( pool.submit( [algorithm, raw = std::move( current )] () mutable
+			{
+				return compress_frame( algorithm, std::move( raw ) );
+			} ) );
+
+			current = {};
+			current.reserve( options.m_frame_size );
+		};
+
+		//
+		// append to the current frame, a full frame goes to the workers
+		//
+		auto append = [&] ( const char* data, std::uint32_t pos, std::uint32_t size ) -> void
+		{
+			while ( size )
+			{
+				const auto step = std::min< std::uint32_t >( size, options.m_frame_size - static_cast< std::uint32_t >( current.size() ) );
+				const auto used = current.size();
+
+				current.resize( used + step );
+
+				if ( data )
+				{
+					std::memcpy( current.data() + used, data, step );
+
+					data += step;
+				}
+				else
+				{
+					rez.read_at( pos, current.data() + used, step );
+
+					pos += step;
+				}
+
+				size -= step;
+
+				if ( current.size() == options.m_frame_size )
+					submit_frame();
+			}
+		};
+
+		std::vector< char > index{};
+
+		std::uint64_t stream_size = 0u;
+
+		const auto start = std::chrono::steady_clock::now();
+
+		for ( const auto& item : items )
+		{
+			const auto& res = *item.m_res;
+
+			bundle_entry_t entry{ stream_size, res.m_header.m_size, res.m_header.m_time, static_cast< std::uint32_t >( item.m_path.size() ) };
+
+			index.insert( index.end(), reinterpret_cast< const char* >( &entry ), reinterpret_cast< const char* >( &entry ) + sizeof( entry ) );
+			index.insert( index.end(), item.m_path.begin(), item.m_path.end() );
+
+			std::uint32_t pos  = res.m_header.m_pos;
+			std::uint32_t size = res.m_header.m_size;
+
+			if ( g_dtx_to_lithtech && size >= 0xC )
+			{
+				std::array< char, 0xC > head{};
+
+				rez.read_at( pos, head.data(), static_cast< std::uint32_t >( head.size() ) );
+
+				c_rez_file::convert_dtx( res, head.data(), head.size() );
+
+				append( head.data(), 0u, static_cast< std::uint32_t >( head.size() ) );
+
+				pos  += static_cast< std::uint32_t >( head.size() );
+				size -= static_cast< std::uint32_t >( head.size() );
+			}
+
+			append( nullptr, pos, size );
+
+			stream_size += res.m_header.m_size;
+		}
+
+		submit_frame();
+
+		while ( !pending.empty() )
+			write_frame();
+
+		//
+		// index
+		//
+		header.m_stream_size = stream_size;
+		header.m_index_pos   = out_pos;
+		header.m_frame_count = static_cast< std::uint32_t >( frames.size() );
+		header.m_entry_count = static_cast< std::uint32_t >( items.size() );
+
+		out.write( reinterpret_cast< const char* >( frames.data() ), static_cast< std::streamsize >( frames.size() * sizeof( bundle_frame_t ) ) );
+		out.write( index.data(), static_cast< std::streamsize >( index.size() ) );
+
+		out.seekp( 0 );
+		out.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+
+		const auto elapsed = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+
+		log(
+			"Bundle: {:d} resources, {:d} frames, {:d} -> {:d} bytes ({:.1f}%) in {:.2f}s\n",
+			items.size(),
+			frames.size(),
+			stream_size,
+			out_pos,
+			stream_size ? 100.0 * static_cast< double >( out_pos ) / static_cast< double >( stream_size ) : 0.0,
+			elapsed
+		);
+	}
+	catch ( ... )
+	{
+		// no truncated bundle left behind
+		std::error_code ec{};
+
+		std::filesystem::remove( output, ec );
+
+		throw;
+	}
+}
+
+rez::c_bundle_reader::c_bundle_reader( const std::filesystem::path& path ) :
+	m_reader{ path }
+{
+	m_header = m_reader.read< bundle_header_t >();
+
+	if ( m_header.m_magic != BUNDLE_MAGIC )
+		REZ_THROW( " - Invalid bundle magic" );
+
+	if ( m_header.m_version != BUNDLE_VERSION )
+		REZ_THROW( " - Invalid bundle version (Expected: {:d} | Current: {:d})", BUNDLE_VERSION, m_header.m_version );
+
+	if ( m_header.m_frame_size == 0u )
+		REZ_THROW( " - Invalid bundle frame size" );
+
+	m_reader.seek( static_cast< std::streamoff >( m_header.m_index_pos ) );
+
+	m_frames.resize( m_header.m_frame_count );
+
+	if ( !m_frames.empty() )
+		m_reader.read( m_frames[ 0u ], m_frames.size() * sizeof( bundle_frame_t ) );
+
+	m_entries.resize( m_header.m_entry_count );
+
+	for ( std::size_t i = 0u; i < m_entries.size(); ++i )
+	{
+		auto& entry = m_entries[ i ];
+
+		entry.m_entry = m_reader.read< bundle_entry_t >();
+		entry.m_path.resize( entry.m_entry.m_path_size );
+
+		if ( !entry.m_path.empty() )
+			m_reader.read( entry.m_path[ 0u ], entry.m_path.size() );
+
+		if ( entry.m_entry.m_offset + entry.m_entry.m_size > m_header.m_stream_size )
+			REZ_THROW( " - Invalid bundle entry: {:s}", entry.m_path );
+
+		m_lookup.emplace( to_lower( entry.m_path ), i );
+	}
+
+	if ( !::CreateDecompressor( m_header.m_algorithm, nullptr, &m_decompressor ) )
+		REZ_THROW( " - CreateDecompressor: {:s}", std::system_category().message( ::GetLastError() ) );
+}
+
+rez::c_bundle_reader::~c_bundle_reader()
+{
+	if ( m_decompressor )
+		::CloseDecompressor( m_decompressor );
+}
+
+auto rez::c_bundle_reader::find( const std::string_view path ) const -> const entry_t*
+{
+	std::string key{ path };
+
+	std::replace( key.begin(), key.end(), '\\', '/' );
+
+	const auto it = m_lookup.find( to_lower( std::move( key ) ) );
+
+	return it != m_lookup.end() ? &m_entries[ it->second ] : nullptr;
+}
+
+auto rez::c_bundle_reader::read( const entry_t& entry ) -> std::vector< char >
+{
+	std::vector< char > data( static_cast< std::size_t >( entry.m_entry.m_size ), '\0' );
+
+	std::uint64_t offset = entry.m_entry.m_offset;
+	std::size_t   copied = 0u;
+
+	//
+	// only the frames spanned by the resource
+	//
+	while ( copied < data.size() )
+	{
+		const auto  index = static_cast< std::size_t >( offset / m_header.m_frame_size );
+		const auto& frame = this->read_frame( index );
+
+		const auto begin = static_cast< std::size_t >( offset % m_header.m_frame_size );
+		const auto step  = std::min( data.size() - copied, frame.size() - begin );
+
+		std::memcpy( data.data() + copied, frame.data() + begin, step );
+
+		copied += step;
+		offset += step;
+	}
+
+	return data;
+}
+
+auto rez::c_bundle_reader::read_frame( const std::size_t index ) -> const std::vector< char >&
+{
+	if ( index == m_frame_index )
+		return m_frame;
+
+	// m_frame is overwritten below, a failed decode must not leave it cached under the old index
+	m_frame_index = std::numeric_limits< std::size_t >::max();
+
+	if ( index >= m_frames.size() )
+		REZ_THROW( " - Invalid bundle frame (Index: {:d} | Count: {:d})", index, m_frames.size() );
+
+	const auto& frame = m_frames[ index ];
+
+	const auto raw_size = static_cast< std::size_t >(
+		std::min< std::uint64_t >( m_header.m_frame_size, m_header.m_stream_size - static_cast< std::uint64_t >( index ) * m_header.m_frame_size )
+	);
+
+	m_compressed.resize( frame.m_size );
+
+	m_reader.seek( static_cast< std::streamoff >( frame.m_pos ) );
+
+	if ( !m_compressed.empty() )
+		m_reader.read( m_compressed[ 0u ], m_compressed.size() );
+
+	if ( frame.m_flags & bundle_frame_flags_stored )
+	{
+		m_frame = m_compressed;
+	}
+	else
+	{
+		m_frame.resize( raw_size );
+
+		SIZE_T size = 0u;
+
+		if ( !::Decompress( m_decompressor, m_compressed.data(), m_compressed.size(), m_frame.data(), m_frame.size(), &size ) )
+			REZ_THROW( " - Decompress: {:s}", std::system_category().message( ::GetLastError() ) );
+
+		m_frame.resize( size );
+	}
+
+	if ( m_frame.size() != raw_size )
+		REZ_THROW( " - Invalid bundle frame size (Expected: {:d} | Current: {:d})", raw_size, m_frame.size() );
+
+	m_frame_index = index;
+
+	return m_frame;
+}
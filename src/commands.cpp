@@ -0,0 +1,963 @@
+#include "pch.hpp"
+#include "commands.hpp"
+
+#include "arguments.hpp"
+#include "async.hpp"
+#include "buffer_pool.hpp"
+#include "bundle.hpp"
+#include "compact.hpp"
+#include "daemon.hpp"
+#include "durability.hpp"
+#include "io_tuning.hpp"
+#include "name_index.hpp"
+#include "packed.hpp"
+#include "patch.hpp"
+#include "rez.hpp"
+#include "rez_file.hpp"
+#include "search.hpp"
+#include "shard.hpp"
+#include "throttle.hpp"
+
+namespace rez::cmd
+{
+
+struct command_t
+{
+	std::string_view m_name;
+	std::string_view m_usage;
+
+	int ( *m_run )( c_arguments& args );
+};
+
+/**
+ * @brief write a resource to disk
+ */
+static void write_file( const std::filesystem::path& output, const std::vector< char >& data )
+{
+	std::ofstream out{};
+	out.exceptions( std::ios::badbit | std::ios::failbit );
+	out.open( output, std::ios::binary );
+	out.write( data.data(), static_cast< std::streamsize >( data.size() ) );
+
+	log( "{:s}: {:d} bytes\n", output.string(), data.size() );
+}
+
+/**
+ * @brief [--max-read SIZE] [--max-write SIZE] [--max-creates N] [--throttle-file FILE]
+ *        [--durability none|batched|strict] [--batch-files N] [--batch-size SIZE]
+ */
+static void write_options( c_arguments& args )
+{
+	throttle_limits_t limits{};
+
+	limits.m_read    = args.option( "max-read", limits.m_read );
+	limits.m_write   = args.option( "max-write", limits.m_write );
+	limits.m_creates = args.option( "max-creates", limits.m_creates );
+
+	g_throttle.set_limits( limits );
+
+	if ( const auto file = args.option( "throttle-file" ) )
+		g_throttle.set_control_file( std::filesystem::path{ *file } );
+
+	if ( const auto durability = args.option( "durability" ) )
+		g_durability.m_mode = parse_durability( *durability );
+
+	g_durability.m_batch_files = args.option( "batch-files", g_durability.m_batch_files );
+	g_durability.m_batch_bytes = args.option( "batch-size", g_durability.m_batch_bytes );
+
+	if ( g_durability.m_batch_files == 0u )
+		REZ_THROW( "Invalid value for --batch-files: 0" );
+}
+
+/**
+ * @brief [--memory SIZE] [--large-pages] [--calibrate] [--chunk-size SIZE] [--parallel-chunks N] [--parallel-threshold SIZE] [--serial-index] [--salvage] [--sparse]
+ *        [--max-read SIZE] [--max-write SIZE] [--max-creates N] [--throttle-file FILE]
+ *        [--durability none|batched|strict] [--batch-files N] [--batch-size SIZE]
+ */
+static void io_options( c_arguments& args )
+{
+	g_memory_budget = args.option( "memory", g_memory_budget );
+	g_large_pages   = args.flag( "large-pages" );
+	g_calibrate     = args.flag( "calibrate" );
+
+	// --calibrate only measures what isn't given here
+	if ( const auto value = args.option( "chunk-size" ) )
+	{
+		g_io_tuning.m_chunk_size = c_arguments::parse< std::size_t >( "chunk-size", *value );
+		g_io_fixed.m_chunk_size  = true;
+	}
+
+	if ( const auto value = args.option( "parallel-chunks" ) )
+	{
+		g_io_tuning.m_concurrency = c_arguments::parse< std::size_t >( "parallel-chunks", *value );
+		g_io_fixed.m_concurrency  = true;
+	}
+
+	g_io_tuning.m_parallel_threshold = args.option( "parallel-threshold", g_io_tuning.m_parallel_threshold );
+
+	g_parallel_index = !args.flag( "serial-index" );
+	g_salvage        = args.flag( "salvage" );
+	g_sparse         = args.flag( "sparse" );
+
+	if ( g_io_tuning.m_chunk_size == 0u )
+		REZ_THROW( "Invalid value for --chunk-size: 0" );
+
+	if ( g_io_tuning.m_concurrency == 0u )
+		REZ_THROW( "Invalid value for --parallel-chunks: 0" );
+
+	write_options( args );
+}
+
+/**
+ * @brief console control handler installed for a scope, removed on every way out of it
+ */
+class c_ctrl_handler
+{
+public:
+	c_ctrl_handler( const PHANDLER_ROUTINE handler, const bool install = true ) :
+		m_handler{ install ? handler : nullptr }
+	{
+		if ( m_handler )
+			::SetConsoleCtrlHandler( m_handler, TRUE );
+	}
+
+	~c_ctrl_handler()
+	{
+		if ( m_handler )
+			::SetConsoleCtrlHandler( m_handler, FALSE );
+	}
+
+	c_ctrl_handler( const c_ctrl_handler& ) = delete;
+	auto operator=( const c_ctrl_handler& ) -> c_ctrl_handler& = delete;
+private:
+	PHANDLER_ROUTINE m_handler{};
+};
+
+//
+// Ctrl+Break lifts the throttle limits and restores them, Ctrl+C still ends the run
+//
+static BOOL WINAPI throttle_handler( const DWORD type )
+{
+	if ( type != CTRL_BREAK_EVENT )
+		return FALSE;
+
+	log( " - Throttle: {:s}\n", g_throttle.toggle() ? "off" : "on" );
+
+	return TRUE;
+}
+
+static void log_throttle_stats()
+{
+	const auto stats = g_throttle.stats();
+
+	log(
+		"Throttled: {:.2f}s reading, {:.2f}s writing, {:.2f}s creating (summed over the threads)\n",
+		stats.m_read_seconds,
+		stats.m_write_seconds,
+		stats.m_create_seconds
+	);
+}
+
+static void log_buffer_stats()
+{
+	const auto stats = shared_buffer_pool().stats();
+
+	log(
+		"Buffers: {:d} acquired, {:d} reused, {:d} waits, peak {:d}K{:s}\n",
+		stats.m_acquired,
+		stats.m_reused,
+		stats.m_waits,
+		stats.m_peak >> 10u,
+		stats.m_large_pages ? " (large pages)" : ""
+	);
+}
+
+/**
+ * @brief extract <archives...> <output> [--overlay] [--shard i/N] [--shard-wait SECONDS] [--resume] [--dtx] [io options]
+ */
+static auto run_extract( c_arguments& args ) -> int
+{
+	io_options( args );
+
+	const bool overlay = args.flag( "overlay" );
+
+	if ( const auto shard = args.option( "shard" ) )
+		parse_shard( *shard, g_shard_index, g_shard_count );
+
+	g_shard_wait = args.option( "shard-wait", g_shard_wait );
+
+	if ( overlay && g_shard_count > 1u )
+		REZ_THROW( "--shard can't be combined with --overlay" );
+
+	g_resume = args.flag( "resume" );
+
+	if ( overlay && g_resume )
+		REZ_THROW( "--resume can't be combined with --overlay" );
+
+	g_dtx_to_lithtech = args.flag( "dtx" );
+
+	const auto values = args.positional();
+
+	if ( values.size() < 2u )
+		REZ_THROW( "Expected archives and output directory" );
+
+	const std::vector< std::filesystem::path > file_path( values.begin(), values.end() - 1 );
+	const std::filesystem::path                save_path{ values.back() };
+
+	std::filesystem::create_directories( save_path );
+
+	const bool throttled = g_throttle.active();
+
+	std::size_t failed = 0u;
+
+	{
+		const c_ctrl_handler handler{ throttle_handler, throttled };
+
+		failed = overlay ? extract_overlay( file_path, save_path, true ) : extract( file_path, save_path );
+	}
+
+	if ( throttled )
+		log_throttle_stats();
+
+	log_buffer_stats();
+
+	if ( failed )
+	{
+		log( "{:d} of {:d} archives failed\n", failed, file_path.size() );
+
+		return 1;
+	}
+
+	return 0;
+}
+
+//
+// set by Ctrl+C/Ctrl+Break while an async extraction runs
+//
+static std::stop_source stop_source{};
+
+static BOOL WINAPI ctrl_handler( const DWORD type )
+{
+	if ( type != CTRL_C_EVENT && type != CTRL_BREAK_EVENT )
+		return FALSE;
+
+	stop_source.request_stop();
+
+	return TRUE;
+}
+
+/**
+ * @brief extract-async <archives...> <output> [--hot PREFIX] [--threads N] [--dtx] [--sparse]
+ */
+static auto run_extract_async( c_arguments& args ) -> int
+{
+	const auto hot     = args.option( "hot" );
+	const auto threads = args.option( "threads", std::size_t{ std::thread::hardware_concurrency() } );
+
+	g_dtx_to_lithtech = args.flag( "dtx" );
+	g_sparse          = args.flag( "sparse" );
+
+	const auto values = args.positional();
+
+	if ( values.size() < 2u )
+		REZ_THROW( "Expected archives and output directory" );
+
+	const std::filesystem::path save_path{ values.back() };
+
+	std::filesystem::create_directories( save_path );
+
+	c_pool_executor executor{ threads };
+
+	async_options_t options{};
+
+	options.m_executor = &executor;
+	options.m_stop     = stop_source.get_token();
+
+	if ( hot )
+	{
+		options.m_resource_priority = [prefix = to_lower( std::string{ *hot } )] ( const std::filesystem::path& path ) -> int
+		{
+			return to_lower( path.generic_string() ).starts_with( prefix ) ? 1 : 0;
+		};
+	}
+
+	options.m_progress = [] ( const progress_t& progress ) -> void
+	{
+		// every 10%
+		const auto step = std::max< std::size_t >( progress.m_total_resources / 10u, 1u );
+
+		if ( progress.m_resources % step == 0u || progress.m_resources == progress.m_total_resources )
+			log( " - {:d}/{:d} resources, {:d}/{:d} bytes\n", progress.m_resources, progress.m_total_resources, progress.m_bytes, progress.m_total_bytes );
+	};
+
+	std::vector< c_task< async_result_t > > tasks{};
+
+	for ( auto it = values.begin(); it != values.end() - 1; ++it )
+		tasks.emplace_back( extract_async( std::filesystem::path{ *it }, save_path, options ) );
+
+	const c_ctrl_handler handler{ ctrl_handler };
+
+	int result = 0;
+
+	try
+	{
+		const auto results = sync_wait( when_all( std::move( tasks ) ) );
+
+		for ( std::size_t i = 0u; i < results.size(); ++i )
+		{
+			if ( !results[ i ].m_error.empty() )
+			{
+				log( "{:s}: failed{:s}\n", values[ i ], results[ i ].m_error );
+
+				result = 1;
+
+				continue;
+			}
+
+			log( "{:s}: {:d} resources, {:d} bytes, {:d} failed\n", values[ i ], results[ i ].m_resources, results[ i ].m_bytes, results[ i ].m_failed );
+
+			if ( results[ i ].m_failed )
+				result = 1;
+		}
+	}
+	catch ( const c_cancelled& )
+	{
+		log( "Cancelled\n" );
+
+		result = 1;
+	}
+
+	return result;
+}
+
+/**
+ * @brief get <archive> <resource path> [output file]
+ */
+static auto run_get( c_arguments& args ) -> int
+{
+	const auto values = args.positional();
+
+	if ( values.size() < 2u || values.size() > 3u )
+		REZ_THROW( "Expected archive and resource path" );
+
+	auto rez = c_rez_file{ std::filesystem::path{ values[ 0 ] } };
+
+	rez.load();
+
+	const auto res = rez.find( values[ 1 ] );
+
+	if ( !res )
+	{
+		log( "Not found: {:s}\n", values[ 1 ] );
+
+		return 1;
+	}
+
+	const std::filesystem::path output = values.size() == 3u ?
+		std::filesystem::path{ values[ 2 ] } :
+		std::filesystem::path{ c_rez_file::resource_filename( *res ) };
+
+	write_file( output, rez.read_resource( *res ) );
+
+	return 0;
+}
+
+/**
+ * @brief search <pattern> <archives...> [--pattern TEXT]... [--type EXT[,EXT...]] [--ignore-case] [--threads N]
+ */
+static auto run_search( c_arguments& args ) -> int
+{
+	search_options_t options{};
+
+	options.m_threads     = args.option( "threads", options.m_threads );
+	options.m_ignore_case = args.flag( "ignore-case" );
+
+	while ( const auto pattern = args.option( "pattern" ) )
+		options.m_patterns.emplace_back( *pattern );
+
+	if ( const auto types = args.option( "type" ) )
+	{
+		for ( std::size_t begin = 0u; begin <= types->size(); )
+		{
+			const auto end = std::min( types->find( ',', begin ), types->size() );
+
+			if ( end > begin )
+				options.m_types.emplace_back( to_lower( std::string{ types->substr( begin, end - begin ) } ) );
+
+			begin = end + 1u;
+		}
+	}
+
+	const auto values = args.positional();
+
+	if ( values.size() < 2u )
+		REZ_THROW( "Expected pattern and archives" );
+
+	options.m_patterns.emplace( options.m_patterns.begin(), values.front() );
+
+	const std::vector< std::filesystem::path > file_path( values.begin() + 1, values.end() );
+
+	const auto stats = search_archives( file_path, options, [&options] ( const search_hit_t& hit )
+	{
+		if ( options.m_patterns.size() > 1u )
+			log( "{:s}:{:s}:{:d}: {:s}\n", hit.m_archive.string(), hit.m_path, hit.m_offset, options.m_patterns[ hit.m_pattern ] );
+		else
+			log( "{:s}:{:s}:{:d}\n", hit.m_archive.string(), hit.m_path, hit.m_offset );
+	} );
+
+	log(
+		" - Search: {:d} archives, {:d} resources, {:d} bytes in {:.2f}s ({:.0f} MB/s), {:d} hits\n",
+		stats.m_archives,
+		stats.m_resources,
+		stats.m_bytes,
+		stats.m_seconds,
+		static_cast< double >( stats.m_bytes ) / 1048576.0 / std::max( stats.m_seconds, 1e-6 ),
+		stats.m_hits
+	);
+
+	return stats.m_hits ? 0 : 1;
+}
+
+/**
+ * @return matches, including the ones past the limit
+ */
+static auto log_names( const c_name_search& search, const std::string_view query, const bool fuzzy, const std::size_t limit ) -> std::size_t
+{
+	const auto result = search.find( query, fuzzy, limit );
+
+	for ( const auto& hit : result.m_hits )
+	{
+		const auto& index       = *hit.m_index;
+		const auto  description = index.description( hit.m_entry );
+
+		log( "{:s}:{:s}", index.archive().string(), index.path( hit.m_entry ) );
+
+		if ( !description.empty() )
+			log( " ({:s})", description );
+
+		if ( fuzzy )
+			log( " [{:.0f}%]", hit.m_score * 100.0 );
+
+		log( "\n" );
+	}
+
+	log( " - {:d} matches ({:d} shown) in {:.3f}ms\n", result.m_total, result.m_hits.size(), result.m_seconds * 1000.0 );
+
+	return result.m_total;
+}
+
+/**
+ * @brief find <archives...> [--query TEXT] [--fuzzy] [--limit N] [--save] [--rebuild] [--threads N]
+ */
+static auto run_find( c_arguments& args ) -> int
+{
+	name_search_options_t options{};
+
+	options.m_threads = args.option( "threads", options.m_threads );
+	options.m_save    = args.flag( "save" );
+	options.m_rebuild = args.flag( "rebuild" );
+
+	const auto query = args.option( "query" );
+	const auto fuzzy = args.flag( "fuzzy" );
+	const auto limit = args.option( "limit", std::size_t{ 50u } );
+
+	const auto values = args.positional();
+
+	if ( values.empty() )
+		REZ_THROW( "Expected archives" );
+
+	const std::vector< std::filesystem::path > file_path( values.begin(), values.end() );
+
+	const c_name_search search{ file_path, options };
+
+	log(
+		" - Index: {:d} archives ({:d} loaded), {:d} entries in {:.2f}s\n",
+		search.indexes().size(),
+		search.loaded(),
+		search.entries(),
+		search.seconds()
+	);
+
+	if ( query )
+		return log_names( search, *query, fuzzy, limit ) ? 0 : 1;
+
+	//
+	// one query per line, "~" in front for a fuzzy one, an empty line quits
+	//
+	for ( std::string line{}; ; )
+	{
+		log( "> " );
+
+		if ( !std::getline( std::cin, line ) || line.empty() )
+			break;
+
+		if ( line.front() == '~' )
+			log_names( search, std::string_view{ line }.substr( 1u ), true, limit );
+		else
+			log_names( search, line, fuzzy, limit );
+	}
+
+	return 0;
+}
+
+/**
+ * @brief info <archives...>
+ */
+static auto run_info( c_arguments& args ) -> int
+{
+	const auto values = args.positional();
+
+	if ( values.empty() )
+		REZ_THROW( "Expected archives" );
+
+	int result = 0;
+
+	//
+	// only the header is read, a bad archive doesn't stop the others
+	//
+	for ( const auto value : values )
+	{
+		try
+		{
+			auto rez = c_rez_file{ std::filesystem::path{ value } };
+
+			rez.load();
+
+			const auto& header = rez.header();
+
+			log(
+				"{:s}: {:s} (Version: {:d} | Type: {:s} | Title: {:s} | Root: {:d}/{:d} | Sorted: {:d})\n",
+				value,
+				header_layout( header ).m_name,
+				header.m_file_format_version,
+				header.m_file_type,
+				header.m_user_title,
+				header.m_root_dir_pos,
+				header.m_root_dir_size,
+				header.m_is_sorted
+			);
+		}
+		catch ( const std::exception& e )
+		{
+			log( "{:s}: [ERROR]{:s}\n", value, e.what() );
+
+			result = 1;
+		}
+	}
+
+	return result;
+}
+
+/**
+ * @brief bundle <archive> <output> [--level N] [--memory SIZE] [--frame-size SIZE] [--threads N] [--dtx]
+ */
+static auto run_bundle( c_arguments& args ) -> int
+{
+	bundle_options_t options{};
+
+	options.m_level         = args.option( "level", options.m_level );
+	options.m_memory_budget = args.option( "memory", options.m_memory_budget );
+	options.m_frame_size    = args.option( "frame-size", options.m_frame_size );
+	options.m_threads       = args.option( "threads", options.m_threads );
+
+	g_dtx_to_lithtech = args.flag( "dtx" );
+
+	const auto values = args.positional();
+
+	if ( values.size() != 2u )
+		REZ_THROW( "Expected archive and output file" );
+
+	auto rez = c_rez_file{ std::filesystem::path{ values[ 0 ] } };
+
+	rez.load();
+
+	write_bundle( rez, std::filesystem::path{ values[ 1 ] }, options );
+
+	return 0;
+}
+
+/**
+ * @brief bundle-get <bundle> <resource path> [output file]
+ */
+static auto run_bundle_get( c_arguments& args ) -> int
+{
+	const auto values = args.positional();
+
+	if ( values.size() < 2u || values.size() > 3u )
+		REZ_THROW( "Expected bundle and resource path" );
+
+	auto bundle = c_bundle_reader{ std::filesystem::path{ values[ 0 ] } };
+
+	const auto entry = bundle.find( values[ 1 ] );
+
+	if ( !entry )
+	{
+		log( "Not found: {:s}\n", values[ 1 ] );
+
+		return 1;
+	}
+
+	const std::filesystem::path output = values.size() == 3u ?
+		std::filesystem::path{ values[ 2 ] } :
+		std::filesystem::path{ entry->m_path }.filename();
+
+	write_file( output, bundle.read( *entry ) );
+
+	return 0;
+}
+
+/**
+ * @brief pack <archive> <output> [--align SIZE] [--dtx]
+ */
+static auto run_pack( c_arguments& args ) -> int
+{
+	const auto alignment = args.option( "align", std::uint32_t{ 0x1000u } );
+
+	g_dtx_to_lithtech = args.flag( "dtx" );
+
+	const auto values = args.positional();
+
+	if ( values.size() != 2u )
+		REZ_THROW( "Expected archive and output file" );
+
+	auto rez = c_rez_file{ std::filesystem::path{ values[ 0 ] } };
+
+	rez.load();
+
+	write_packed( rez, std::filesystem::path{ values[ 1 ] }, alignment );
+
+	return 0;
+}
+
+/**
+ * @brief pack-get <packed file> <resource path> [output file]
+ */
+static auto run_pack_get( c_arguments& args ) -> int
+{
+	const auto values = args.positional();
+
+	if ( values.size() < 2u || values.size() > 3u )
+		REZ_THROW( "Expected packed file and resource path" );
+
+	const auto packed = c_packed_file{ std::filesystem::path{ values[ 0 ] } };
+
+	const auto entry = packed.find( values[ 1 ] );
+
+	if ( !entry )
+	{
+		log( "Not found: {:s}\n", values[ 1 ] );
+
+		return 1;
+	}
+
+	const std::filesystem::path output = values.size() == 3u ?
+		std::filesystem::path{ values[ 2 ] } :
+		std::filesystem::path{ packed.path( *entry ) }.filename();
+
+	const auto data = packed.data( *entry );
+
+	write_file( output, { data.begin(), data.end() } );
+
+	return 0;
+}
+
+/**
+ * @brief compact <archive> <output> [--align SIZE] [--profile FILE]
+ */
+static auto run_compact( c_arguments& args ) -> int
+{
+	compact_options_t options{};
+
+	options.m_alignment = args.option( "align", options.m_alignment );
+
+	if ( const auto profile = args.option( "profile" ) )
+		options.m_profile = std::filesystem::path{ *profile };
+
+	const auto values = args.positional();
+
+	if ( values.size() != 2u )
+		REZ_THROW( "Expected archive and output file" );
+
+	auto rez = c_rez_file{ std::filesystem::path{ values[ 0 ] } };
+
+	rez.load();
+
+	const auto stats = write_compacted( rez, std::filesystem::path{ values[ 1 ] }, options );
+
+	log(
+		" - Compact: {:d} resources ({:d} shared), {:d} -> {:d} bytes, {:d} reclaimed ({:d} dead)\n",
+		stats.m_resources,
+		stats.m_shared,
+		stats.m_old_size,
+		stats.m_new_size,
+		static_cast< std::int64_t >( stats.m_old_size ) - static_cast< std::int64_t >( stats.m_new_size ),
+		stats.m_dead_bytes
+	);
+
+	log( " - Fragmentation: {:.1f}% -> {:.1f}%\n", stats.m_fragmentation_before * 100.0, stats.m_fragmentation_after * 100.0 );
+
+	if ( !options.m_profile.empty() )
+		log( " - Profile: {:d} placed first, {:d} not found\n", stats.m_profiled, stats.m_missing );
+
+	return 0;
+}
+
+/**
+ * @brief diff <old> <new> <patch> [--delta-threshold SIZE]
+ */
+static auto run_diff( c_arguments& args ) -> int
+{
+	patch_options_t options{};
+
+	options.m_delta_threshold = args.option( "delta-threshold", options.m_delta_threshold );
+
+	const auto values = args.positional();
+
+	if ( values.size() != 3u )
+		REZ_THROW( "Expected old archive, new archive and patch file" );
+
+	auto old_rez = c_rez_file{ std::filesystem::path{ values[ 0 ] } };
+	auto new_rez = c_rez_file{ std::filesystem::path{ values[ 1 ] } };
+
+	old_rez.load();
+	new_rez.load();
+
+	const auto stats = write_patch( old_rez, new_rez, std::filesystem::path{ values[ 2 ] }, options );
+
+	log(
+		" - Index: {:d} added, {:d} removed, {:d} modified, {:d} unchanged\n",
+		stats.m_added,
+		stats.m_removed,
+		stats.m_modified,
+		stats.m_unchanged
+	);
+
+	log(
+		" - Patch: {:d} payloads copied, {:d} delta encoded, {:d} copied bytes, {:d} literal bytes, {:d} ops\n",
+		stats.m_copied,
+		stats.m_delta,
+		stats.m_copy_bytes,
+		stats.m_literal_bytes,
+		stats.m_op_count
+	);
+
+	log(
+		" - Size: {:d} bytes for a {:d} byte archive ({:.2f}%)\n",
+		stats.m_patch_size,
+		stats.m_new_size,
+		stats.m_new_size ? 100.0 * static_cast< double >( stats.m_patch_size ) / static_cast< double >( stats.m_new_size ) : 0.0
+	);
+
+	return 0;
+}
+
+/**
+ * @brief patch <old> <patch> <output>
+ */
+static auto run_patch( c_arguments& args ) -> int
+{
+	const auto values = args.positional();
+
+	if ( values.size() != 3u )
+		REZ_THROW( "Expected old archive, patch file and output file" );
+
+	const auto stats = apply_patch( std::filesystem::path{ values[ 0 ] }, std::filesystem::path{ values[ 1 ] }, std::filesystem::path{ values[ 2 ] } );
+
+	log(
+		" - Patched: {:d} bytes ({:d} copied, {:d} from the patch), verified\n",
+		stats.m_new_size,
+		stats.m_copy_bytes,
+		stats.m_literal_bytes
+	);
+
+	return 0;
+}
+
+/**
+ * @brief bench-durability <directory> [--files N] [--file-size SIZE] [--batch-files N] [--batch-size SIZE]
+ */
+static auto run_bench_durability( c_arguments& args ) -> int
+{
+	durability_t durability{};
+
+	durability.m_batch_files = args.option( "batch-files", durability.m_batch_files );
+	durability.m_batch_bytes = args.option( "batch-size", durability.m_batch_bytes );
+
+	const auto files     = args.option( "files", std::size_t{ 2000u } );
+	const auto file_size = args.option( "file-size", std::uint32_t{ 0x10000u } );
+
+	if ( durability.m_batch_files == 0u )
+		REZ_THROW( "Invalid value for --batch-files: 0" );
+
+	const auto values = args.positional();
+
+	if ( values.size() != 1u )
+		REZ_THROW( "Expected a directory on the output device" );
+
+	const auto results = bench_durability( std::filesystem::path{ values[ 0 ] }, files, file_size, durability );
+
+	log( "Durability: {:d} files of {:d} bytes\n", files, file_size );
+
+	const auto baseline = results.front().m_seconds;
+
+	for ( const auto& result : results )
+	{
+		log(
+			" - {:<8s} {:8.2f}s {:10.0f} files/s {:8.1f} MB/s {:7.2f}x\n",
+			durability_name( result.m_mode ),
+			result.m_seconds,
+			result.m_files_per_second,
+			result.m_bytes_per_second / 1048576.0,
+			result.m_seconds / baseline
+		);
+	}
+
+	return 0;
+}
+
+/**
+ * @brief salvage <archive> <output> [--dtx]
+ */
+static auto run_salvage( c_arguments& args ) -> int
+{
+	g_dtx_to_lithtech = args.flag( "dtx" );
+
+	const auto values = args.positional();
+
+	if ( values.size() != 2u )
+		REZ_THROW( "Expected archive and output directory" );
+
+	const std::filesystem::path save_path{ values[ 1 ] };
+
+	std::filesystem::create_directories( save_path );
+
+	auto rez = c_rez_file{ std::filesystem::path{ values[ 0 ] } };
+
+	rez.salvage();
+
+	return rez.extract( save_path ) ? 1 : 0;
+}
+
+/**
+ * @brief daemon <socket> <archives...> [--threads N] [--dtx] [--serial-index] [--sparse]
+ *        [--max-read SIZE] [--max-write SIZE] [--max-creates N] [--throttle-file FILE]
+ *        [--durability none|batched|strict] [--batch-files N] [--batch-size SIZE]
+ */
+static auto run_daemon( c_arguments& args ) -> int
+{
+	daemon_options_t options{};
+
+	options.m_threads = args.option( "threads", options.m_threads );
+
+	g_dtx_to_lithtech = args.flag( "dtx" );
+	g_parallel_index  = !args.flag( "serial-index" );
+	g_sparse          = args.flag( "sparse" );
+
+	write_options( args );
+
+	const auto values = args.positional();
+
+	if ( values.size() < 2u )
+		REZ_THROW( "Expected socket and archives" );
+
+	options.m_socket = std::filesystem::path{ values[ 0 ] };
+	options.m_archives.assign( values.begin() + 1, values.end() );
+
+	rez::run_daemon( options );
+
+	return 0;
+}
+
+/**
+ * @brief request <socket> <request...> [--output FILE]
+ */
+static auto run_request( c_arguments& args ) -> int
+{
+	const auto output = args.option( "output" );
+
+	const auto values = args.positional();
+
+	if ( values.size() < 2u )
+		REZ_THROW( "Expected socket and request" );
+
+	std::string request{ values[ 1 ] };
+
+	for ( auto it = values.begin() + 2; it != values.end(); ++it )
+		request.append( "\t" ).append( *it );
+
+	std::string payload{};
+
+	if ( !request_daemon( std::filesystem::path{ values[ 0 ] }, request, payload ) )
+	{
+		log( "Error: {:s}\n", payload );
+
+		return 1;
+	}
+
+	if ( output )
+		write_file( std::filesystem::path{ *output }, { payload.begin(), payload.end() } );
+	else
+		log( "{:s}", payload );
+
+	return 0;
+}
+
+static constexpr std::array commands =
+{
+	command_t{ "extract",       "extract <archives...> <output> [--overlay] [--shard i/N] [--shard-wait SECONDS] [--resume] [--dtx] [--memory SIZE] [--large-pages] [--calibrate] [--chunk-size SIZE] [--parallel-chunks N] [--parallel-threshold SIZE] [--serial-index] [--salvage] [--sparse] [--max-read SIZE] [--max-write SIZE] [--max-creates N] [--throttle-file FILE] [--durability none|batched|strict] [--batch-files N] [--batch-size SIZE]", run_extract },
+	command_t{ "extract-async", "extract-async <archives...> <output> [--hot PREFIX] [--threads N] [--dtx] [--sparse]", run_extract_async },
+	command_t{ "get",           "get <archive> <resource path> [output file]", run_get },
+	command_t{ "info",          "info <archives...>", run_info },
+	command_t{ "search",        "search <pattern> <archives...> [--pattern TEXT]... [--type EXT[,EXT...]] [--ignore-case] [--threads N]", run_search },
+	command_t{ "find",          "find <archives...> [--query TEXT] [--fuzzy] [--limit N] [--save] [--rebuild] [--threads N]", run_find },
+	command_t{ "salvage",       "salvage <archive> <output> [--dtx]", run_salvage },
+	command_t{ "bundle",        "bundle <archive> <output> [--level N] [--memory SIZE] [--frame-size SIZE] [--threads N] [--dtx]", run_bundle },
+	command_t{ "bundle-get",    "bundle-get <bundle> <resource path> [output file]", run_bundle_get },
+	command_t{ "pack",          "pack <archive> <output> [--align SIZE] [--dtx]", run_pack },
+	command_t{ "pack-get",      "pack-get <packed file> <resource path> [output file]", run_pack_get },
+	command_t{ "compact",       "compact <archive> <output> [--align SIZE] [--profile FILE]", run_compact },
+	command_t{ "diff",          "diff <old> <new> <patch> [--delta-threshold SIZE]", run_diff },
+	command_t{ "patch",         "patch <old> <patch> <output>", run_patch },
+	command_t{ "bench-durability", "bench-durability <directory> [--files N] [--file-size SIZE] [--batch-files N] [--batch-size SIZE]", run_bench_durability },
+	command_t{ "daemon",        "daemon <socket> <archives...> [--threads N] [--dtx] [--serial-index] [--sparse] [--max-read SIZE] [--max-write SIZE] [--max-creates N] [--throttle-file FILE] [--durability none|batched|strict] [--batch-files N] [--batch-size SIZE]", run_daemon },
+	command_t{ "request",       "request <socket> <request...> [--output FILE]", run_request },
+};
+
+static auto usage() -> int
+{
+	log( "Usage: RezExtract <command> [arguments]\n" );
+
+	for ( const auto& command : commands )
+		log( "  {:s}\n", command.m_usage );
+
+	return 1;
+}
+
+}
+
+auto rez::cmd::run( const std::vector< std::string_view >& args ) -> int
+{
+	if ( args.empty() )
+		return usage();
+
+	const auto it = std::find_if( commands.begin(), commands.end(), [&args] ( const command_t& command )
+	{
+		return command.m_name == args.front();
+	} );
+
+	if ( it == commands.end() )
+		return usage();
+
+	try
+	{
+		c_arguments arguments{ { args.begin() + 1, args.end() } };
+
+		return it->m_run( arguments );
+	}
+	catch ( const std::exception& e )
+	{
+		log( "[FATAL] {:s}\n", e.what() );
+	}
+
+	return 1;
+}
@@ -0,0 +1,451 @@
+#include "pch.hpp"
+#include "compact.hpp"
+
+#include "rez_file.hpp"
+
+namespace rez
+{
+
+//
+// a read ahead doesn't cover a larger forward skip
+//
+static constexpr std::uint64_t FRAGMENT_GAP = 0x10000u;
+
+static auto align_up( const std::uint64_t value, const std::uint64_t alignment ) -> std::uint64_t
+{
+	return ( value + alignment - 1u ) & ~( alignment - 1u );
+}
+
+/**
+ * @brief lowercase with forward slashes and no leading slash, profile lines and resource paths compare equal
+ */
+static auto normalize_path( std::string_view path ) -> std::string
+{
+	const auto begin = path.find_first_not_of( " \t/\\" );
+	const auto end   = path.find_last_not_of( " \t\r\n" );
+
+	if ( begin == std::string_view::npos || end == std::string_view::npos || end < begin )
+		return {};
+
+	auto value = to_lower( std::string{ path.substr( begin, end - begin + 1u ) } );
+
+	std::replace( value.begin(), value.end(), '\\', '/' );
+
+	return value;
+}
+
+static void append_u32( std::vector< char >& block, const std::uint32_t value )
+{
+	const auto size = block.size();
+
+	block.resize( size + sizeof( value ) );
+
+	store_le( block.data() + size, value );
+}
+
+static void append_string( std::vector< char >& block, const std::string_view value )
+{
+	block.insert( block.end(), value.begin(), value.end() );
+	block.emplace_back( '\0' );
+}
+
+static auto resource_entry_size( const block_resource_t& res ) -> std::uint32_t
+{
+	return static_cast< std::uint32_t >(
+		entry_layout_t::RES_NAME + res.m_name.size() + 1u + res.m_description.size() + 1u + sizeof( std::uint32_t ) * res.m_keys.size()
+	);
+}
+
+static auto directory_entry_size( const directory_t& dir ) -> std::uint32_t
+{
+	return static_cast< std::uint32_t >( entry_layout_t::DIR_NAME + dir.m_name.size() + 1u );
+}
+
+static void append_resource( std::vector< char >& block, const block_resource_t& res, const std::uint32_t pos )
+{
+	append_u32( block, file_directory_entry_type_resource );
+	append_u32( block, pos );
+	append_u32( block, res.m_header.m_size );
+	append_u32( block, res.m_header.m_time );
+	append_u32( block, res.m_id );
+
+	//
+	// stored reversed in 4 bytes (i.e XML to LMX)
+	//
+	std::array< char, 4u > ext{};
+
+	std::copy_n( res.m_type.rbegin(), std::min( res.m_type.size(), ext.size() ), ext.begin() );
+
+	block.insert( block.end(), ext.begin(), ext.end() );
+
+	append_u32( block, static_cast< std::uint32_t >( res.m_keys.size() ) );
+	append_string( block, res.m_name );
+	append_string( block, res.m_description );
+
+	for ( const auto key : res.m_keys )
+		append_u32( block, key );
+}
+
+static void append_directory( std::vector< char >& block, const directory_t& dir, const std::uint32_t pos, const std::uint32_t size )
+{
+	append_u32( block, file_directory_entry_type_directory );
+	append_u32( block, pos );
+	append_u32( block, size );
+	append_u32( block, dir.m_header.m_time );
+	append_string( block, dir.m_name );
+}
+
+static void patch_u32( std::vector< char >& header, const header_layout_t& layout, std::uint32_t rez_header_t::* member, const std::uint32_t value )
+{
+	const auto field = layout.field( member );
+
+	if ( !field )
+		REZ_THROW( " - Header layout {:s} has no such field", layout.m_name );
+
+	store_le( header.data() + field->m_offset, value );
+}
+
+}
+
+auto rez::fragmentation_score( const std::span< const std::pair< std::uint64_t, std::uint64_t > > extents ) -> double
+{
+	std::size_t reads = 0u;
+	std::size_t seeks = 0u;
+
+	std::optional< std::uint64_t > end{};
+
+	for ( const auto& [pos, size] : extents )
+	{
+		if ( size == 0u )
+			continue;
+
+		if ( end )
+		{
+			++reads;
+
+			if ( pos < *end || pos - *end >= FRAGMENT_GAP )
+				++seeks;
+		}
+
+		end = pos + size;
+	}
+
+	return reads ? static_cast< double >( seeks ) / static_cast< double >( reads ) : 0.0;
+}
+
+auto rez::write_compacted( c_rez_file& rez, const std::filesystem::path& output, const compact_options_t& options ) -> compact_stats_t
+{
+	const auto alignment = options.m_alignment;
+
+	if ( alignment == 0u || ( alignment & ( alignment - 1u ) ) != 0u )
+		REZ_THROW( " - Invalid alignment: {:d}", alignment );
+
+	// the payloads are read while the output is written
+	if ( std::error_code ec{}; std::filesystem::equivalent( output, rez.path(), ec ) )
+		REZ_THROW( " - Output is the input archive: {:s}", output.string() );
+
+	rez.read_index();
+
+	const auto& directories = rez.index().m_directories;
+	const auto& layout      = header_layout( rez.header() );
+
+	static constexpr auto npos = std::numeric_limits<std::size_t>::max();
+
+	compact_stats_t stats{};
+
+	stats.m_old_size = std::filesystem::file_size( rez.path() );
+
+	//
+	// subdirectories per directory, the root block holds the directories without owner
+	//
+	std::vector< std::vector< std::size_t > > children( directories.size() );
+	std::vector< std::size_t >                root{};
+
+	for ( std::size_t d = 0u; d < directories.size(); ++d )
+	{
+		const auto owner = directories[ d ].m_owner_index;
+
+		( owner == npos ? root : children.at( owner ) ).emplace_back( d );
+	}
+
+	//
+	// block sizes don't depend on any position, lay the blocks out in preorder right after the header
+	// so the whole index is a single forward read
+	//
+	std::vector< std::uint32_t > block_size( directories.size(), 0u );
+	std::vector< std::uint32_t > block_pos( directories.size(), 0u );
+
+	std::uint32_t root_size = 0u;
+
+	for ( const auto d : root )
+		root_size += directory_entry_size( directories[ d ] );
+
+	for ( std::size_t d = 0u; d < directories.size(); ++d )
+	{
+		for ( const auto& res : directories[ d ].m_resource )
+			block_size[ d ] += resource_entry_size( res );
+
+		for ( const auto child : children[ d ] )
+			block_size[ d ] += directory_entry_size( directories[ child ] );
+	}
+
+	const std::uint32_t root_pos = layout.size();
+
+	std::uint64_t pos = root_pos + static_cast< std::uint64_t >( root_size );
+
+	for ( std::size_t d = 0u; d < directories.size(); ++d )
+	{
+		if ( block_size[ d ] == 0u )
+			continue;
+
+		block_pos[ d ] = static_cast< std::uint32_t >( pos );
+
+		pos += block_size[ d ];
+	}
+
+	const auto blocks_end = pos;
+
+	//
+	// payload order, the profile first then the directory traversal
+	//
+	struct item_t
+	{
+		std::size_t m_dir;
+		std::size_t m_res;
+	};
+
+	std::vector< item_t > items{};
+
+	for ( std::size_t d = 0u; d < directories.size(); ++d )
+	{
+		for ( std::size_t r = 0u; r < directories[ d ].m_resource.size(); ++r )
+			items.emplace_back( item_t{ d, r } );
+	}
+
+	stats.m_resources = items.size();
+
+	if ( !options.m_profile.empty() )
+	{
+		std::unordered_map< std::string, std::size_t > lookup{};
+
+		for ( std::size_t i = 0u; i < items.size(); ++i )
+		{
+			const auto& res = directories[ items[ i ].m_dir ].m_resource[ items[ i ].m_res ];
+
+			lookup.emplace( normalize_path( ( rez.directory_path( items[ i ].m_dir ) / c_rez_file::resource_filename( res ) ).generic_string() ), i );
+		}
+
+		std::ifstream in{ options.m_profile };
+
+		if ( !in )
+			REZ_THROW( " - Can't open profile: {:s}", options.m_profile.string() );
+
+		std::vector< item_t > ordered{};
+		std::vector< bool >   placed( items.size(), false );
+
+		for ( std::string line{}; std::getline( in, line ); )
+		{
+			const auto key = normalize_path( line );
+
+			if ( key.empty() )
+				continue;
+
+			const auto it = lookup.find( key );
+
+			if ( it == lookup.end() )
+			{
+				++stats.m_missing;
+
+				continue;
+			}
+
+			if ( placed[ it->second ] )
+				continue;
+
+			placed[ it->second ] = true;
+
+			ordered.emplace_back( items[ it->second ] );
+
+			++stats.m_profiled;
+		}
+
+		for ( std::size_t i = 0u; i < items.size(); ++i )
+		{
+			if ( !placed[ i ] )
+				ordered.emplace_back( items[ i ] );
+		}
+
+		items = std::move( ordered );
+	}
+
+	//
+	// payload positions, resources sharing a payload keep sharing it
+	//
+	std::vector< std::vector< std::uint32_t > > res_pos( directories.size() );
+
+	for ( std::size_t d = 0u; d < directories.size(); ++d )
+		res_pos[ d ].resize( directories[ d ].m_resource.size() );
+
+	// ( pos << 32 ) | size of the old payload -> new pos
+	std::unordered_map< std::uint64_t, std::uint32_t > written{};
+
+	std::vector< item_t > copies{};
+
+	std::vector< std::pair< std::uint64_t, std::uint64_t > > before{};
+	std::vector< std::pair< std::uint64_t, std::uint64_t > > after{};
+
+	std::uint64_t payload_bytes = 0u;
+
+	pos = align_up( blocks_end, alignment );
+
+	for ( const auto& item : items )
+	{
+		const auto& header = directories[ item.m_dir ].m_resource[ item.m_res ].m_header;
+
+		auto& new_pos = res_pos[ item.m_dir ][ item.m_res ];
+
+		if ( header.m_size == 0u )
+		{
+			new_pos = static_cast< std::uint32_t >( std::min< std::uint64_t >( pos, std::numeric_limits< std::uint32_t >::max() ) );
+
+			continue;
+		}
+
+		before.emplace_back( header.m_pos, header.m_size );
+
+		const auto extent = ( static_cast< std::uint64_t >( header.m_pos ) << 32u ) | header.m_size;
+
+		if ( const auto it = written.find( extent ); it != written.end() )
+		{
+			new_pos = it->second;
+
+			++stats.m_shared;
+
+			continue;
+		}
+
+		pos = align_up( pos, alignment );
+
+		if ( pos + header.m_size > std::numeric_limits< std::uint32_t >::max() )
+			REZ_THROW( " - Compacted archive exceeds 4GB (Pos: {:d} | Size: {:d})", pos, header.m_size );
+
+		new_pos = static_cast< std::uint32_t >( pos );
+
+		written.emplace( extent, new_pos );
+		copies.emplace_back( item );
+		after.emplace_back( pos, header.m_size );
+
+		payload_bytes += header.m_size;
+		pos           += header.m_size;
+	}
+
+	const auto file_end = pos;
+
+	stats.m_new_size             = file_end;
+	stats.m_fragmentation_before = fragmentation_score( before );
+	stats.m_fragmentation_after  = fragmentation_score( after );
+
+	//
+	// everything the old archive references, the rest is dead space
+	//
+	std::uint64_t used = layout.size() + static_cast< std::uint64_t >( rez.header().m_root_dir_size ) + payload_bytes;
+
+	for ( const auto& dir : directories )
+		used += dir.m_header.m_size;
+
+	stats.m_dead_bytes = stats.m_old_size > used ? stats.m_old_size - used : 0u;
+
+	//
+	// header, copied as is (keys of the encoded variant, titles) with the positions patched
+	//
+	std::vector< char > header( layout.size(), '\0' );
+
+	rez.read_at( 0u, header.data(), static_cast< std::uint32_t >( header.size() ) );
+
+	patch_u32( header, layout, &rez_header_t::m_root_dir_pos, root_size ? root_pos : 0u );
+	patch_u32( header, layout, &rez_header_t::m_root_dir_size, root_size );
+	patch_u32( header, layout, &rez_header_t::m_next_write_pos, static_cast< std::uint32_t >( file_end ) );
+
+	try
+	{
+		std::ofstream out{};
+		out.exceptions( std::ios::badbit | std::ios::failbit );
+		out.open( output, std::ios::binary );
+
+		out.write( header.data(), static_cast< std::streamsize >( header.size() ) );
+
+		//
+		// blocks, resources before the subdirectories: the recursive read gives a block's
+		// resources to the last directory it saw
+		//
+		std::vector< char > block{};
+
+		for ( const auto d : root )
+			append_directory( block, directories[ d ], block_pos[ d ], block_size[ d ] );
+
+		out.write( block.data(), static_cast< std::streamsize >( block.size() ) );
+
+		for ( std::size_t d = 0u; d < directories.size(); ++d )
+		{
+			block.clear();
+
+			for ( std::size_t r = 0u; r < directories[ d ].m_resource.size(); ++r )
+				append_resource( block, directories[ d ].m_resource[ r ], res_pos[ d ][ r ] );
+
+			for ( const auto child : children[ d ] )
+				append_directory( block, directories[ child ], block_pos[ child ], block_size[ child ] );
+
+			out.write( block.data(), static_cast< std::streamsize >( block.size() ) );
+		}
+
+		//
+		// payloads
+		//
+		static constexpr std::uint32_t STEP_DATA_SIZE = 1'048'576u;
+
+		auto data = std::make_unique< char[] >( STEP_DATA_SIZE );
+
+		std::uint64_t offset = blocks_end;
+
+		for ( const auto& item : copies )
+		{
+			const auto& res = directories[ item.m_dir ].m_resource[ item.m_res ];
+
+			static constexpr std::array< char, 0x1000 > zero{};
+
+			for ( const auto to = res_pos[ item.m_dir ][ item.m_res ]; offset < to; )
+			{
+				const auto step = std::min< std::uint64_t >( to - offset, zero.size() );
+
+				out.write( zero.data(), static_cast< std::streamsize >( step ) );
+
+				offset += step;
+			}
+
+			for ( std::uint32_t step = 0u; step < res.m_header.m_size; )
+			{
+				const std::uint32_t step_size = std::min( res.m_header.m_size - step, STEP_DATA_SIZE );
+
+				rez.read_at( res.m_header.m_pos + step, data.get(), step_size );
+
+				out.write( data.get(), step_size );
+
+				step   += step_size;
+				offset += step_size;
+			}
+		}
+
+		out.close();
+	}
+	catch ( ... )
+	{
+		// no truncated archive left behind
+		std::error_code ec{};
+
+		std::filesystem::remove( output, ec );
+
+		throw;
+	}
+
+	return stats;
+}
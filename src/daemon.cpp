@@ -0,0 +1,959 @@
+#include "pch.hpp"
+#include "daemon.hpp"
+
+#include "arguments.hpp"
+#include "durability.hpp"
+#include "mapped_file.hpp"
+#include "rez.hpp"
+#include "rez_file.hpp"
+#include "thread_pool.hpp"
+#include "throttle.hpp"
+#include "writer.hpp"
+
+namespace rez
+{
+
+struct served_resource_t
+{
+	std::string      m_key{}; // lowercase path, '/' separated
+	std::string      m_path{};
+	block_resource_t m_res{};
+};
+
+struct served_archive_t
+{
+	std::filesystem::path            m_path{};
+	std::string                      m_name{}; // lowercase file name
+
+	std::shared_mutex                m_mutex{};
+
+	std::unique_ptr< c_mapped_file > m_file{};
+	std::vector< served_resource_t > m_resources{}; // sorted by key
+
+	std::filesystem::file_time_type  m_time{};
+	std::uintmax_t                   m_size{};
+};
+
+/**
+ * @brief winsock lifetime
+ */
+class c_winsock
+{
+public:
+	c_winsock()
+	{
+		WSADATA data{};
+
+		if ( const auto error = ::WSAStartup( MAKEWORD( 2, 2 ), &data ) )
+			REZ_THROW( " - WSAStartup: {:s}", std::system_category().message( error ) );
+	}
+	~c_winsock()
+	{
+		::WSACleanup();
+	}
+
+	c_winsock( const c_winsock& ) = delete;
+	c_winsock& operator=( const c_winsock& ) = delete;
+};
+
+/**
+ * @brief one end of a stream socket, requests and replies are exchanged line by line
+ */
+class c_connection
+{
+public:
+	c_connection( const SOCKET socket ) :
+		m_socket{ socket }
+	{
+	}
+public:
+	auto read_line( std::string& line ) -> bool
+	{
+		while ( !this->next_line( line ) )
+		{
+			if ( !this->receive() )
+				return false;
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief a line already received, never waits
+	 */
+	auto next_line( std::string& line ) -> bool
+	{
+		const auto end = m_buffer.find( '\n' );
+
+		if ( end == std::string::npos )
+			return false;
+
+		line.assign( m_buffer, 0u, end );
+		m_buffer.erase( 0u, end + 1u );
+
+		if ( !line.empty() && line.back() == '\r' )
+			line.pop_back();
+
+		return true;
+	}
+
+	auto has_line() const -> bool
+	{
+		return m_buffer.find( '\n' ) != std::string::npos;
+	}
+
+	/**
+	 * @brief a single recv of what arrived (blocks when nothing did), false once the peer is gone
+	 */
+	auto receive() -> bool
+	{
+		// a request line never gets near this, don't let a client grow the buffer forever
+		if ( m_buffer.size() > 0x10000u )
+			return false;
+
+		std::array< char, 0x1000u > data{};
+
+		const auto size = ::recv( m_socket, data.data(), static_cast< int >( data.size() ), 0 );
+
+		if ( size <= 0 )
+			return false;
+
+		m_buffer.append( data.data(), static_cast< std::size_t >( size ) );
+
+		return true;
+	}
+
+	auto read( std::string& data, const std::size_t size ) -> bool
+	{
+		data = m_buffer.substr( 0u, size );
+		m_buffer.erase( 0u, data.size() );
+
+		while ( data.size() < size )
+		{
+			std::array< char, 0x10000u > chunk{};
+
+			const auto step = ::recv( m_socket, chunk.data(), static_cast< int >( std::min( chunk.size(), size - data.size() ) ), 0 );
+
+			if ( step <= 0 )
+				return false;
+
+			data.append( chunk.data(), static_cast< std::size_t >( step ) );
+		}
+
+		return true;
+	}
+
+	void send( const char* data, std::size_t size )
+	{
+		while ( size )
+		{
+			const auto step = ::send( m_socket, data, static_cast< int >( std::min< std::size_t >( size, 0x40000000u ) ), 0 );
+
+			if ( step <= 0 )
+				REZ_THROW( " - send: {:s}", std::system_category().message( ::WSAGetLastError() ) );
+
+			data += step;
+			size -= static_cast< std::size_t >( step );
+		}
+	}
+
+	void send( const std::string_view data )
+	{
+		this->send( data.data(), data.size() );
+	}
+
+	void reply( const std::string_view payload )
+	{
+		this->send( std::format( "OK {:d}\n", payload.size() ) );
+		this->send( payload );
+	}
+
+	void reply_error( const std::string_view message )
+	{
+		std::string line{ message };
+
+		// the message is a single line
+		std::replace( line.begin(), line.end(), '\n', ' ' );
+
+		this->send( std::format( "ERR {:s}\n", line ) );
+	}
+private:
+	SOCKET      m_socket;
+	std::string m_buffer{};
+};
+
+/**
+ * @brief lowercase, '/' separated, without leading separators
+ */
+static auto normalize_path( const std::string_view path ) -> std::string
+{
+	auto key = to_lower( std::string{ path.substr( std::min( path.find_first_not_of( "/\\" ), path.size() ) ) } );
+
+	std::replace( key.begin(), key.end(), '\\', '/' );
+
+	return key;
+}
+
+static auto make_address( const std::filesystem::path& path ) -> sockaddr_un
+{
+	sockaddr_un address{};
+
+	address.sun_family = AF_UNIX;
+
+	const auto value = path.string();
+
+	if ( value.empty() || value.size() >= sizeof( address.sun_path ) )
+		REZ_THROW( " - Invalid socket path: {:s}", value );
+
+	std::memcpy( address.sun_path, value.data(), value.size() );
+
+	return address;
+}
+
+static auto connect_socket( const std::filesystem::path& path ) -> SOCKET
+{
+	const auto address = make_address( path );
+
+	const auto socket = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+
+	if ( socket == INVALID_SOCKET )
+		REZ_THROW( " - socket: {:s}", std::system_category().message( ::WSAGetLastError() ) );
+
+	if ( ::connect( socket, reinterpret_cast< const sockaddr* >( &address ), sizeof( address ) ) == SOCKET_ERROR )
+	{
+		const auto error = ::WSAGetLastError();
+
+		::closesocket( socket );
+
+		REZ_THROW( " - connect: {:s}: {:s}", path.string(), std::system_category().message( error ) );
+	}
+
+	return socket;
+}
+
+/**
+ * @brief parse the archive and map it, the paths are resolved once here so requests only search a sorted table
+ */
+static void reindex( served_archive_t& archive, const std::filesystem::file_time_type time, const std::uintmax_t size )
+{
+	archive.m_file.reset();
+	archive.m_resources.clear();
+
+	c_rez_file rez{ archive.m_path };
+
+	rez.load();
+	rez.read_index();
+
+	const auto& directories = rez.index().m_directories;
+
+	std::vector< served_resource_t > resources{};
+
+	for ( std::size_t d = 0u; d < directories.size(); ++d )
+	{
+		const auto dir_path = rez.directory_path( d );
+
+		for ( const auto& res : directories[ d ].m_resource )
+		{
+			auto path = ( dir_path / c_rez_file::resource_filename( res ) ).generic_string();
+
+			resources.emplace_back( served_resource_t{ normalize_path( path ), std::move( path ), res } );
+		}
+	}
+
+	std::sort( resources.begin(), resources.end(), [] ( const served_resource_t& lhs, const served_resource_t& rhs )
+	{
+		return lhs.m_key < rhs.m_key;
+	} );
+
+	//
+	// writers may keep updating the archive in place (share write/delete), a change is noticed by the next request
+	//
+	archive.m_file      = std::make_unique< c_mapped_file >( archive.m_path, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE );
+	archive.m_resources = std::move( resources );
+	archive.m_time      = time;
+	archive.m_size      = size;
+
+	log( "Indexed {:s}: {:d} resources\n", archive.m_path.string(), archive.m_resources.size() );
+}
+
+/**
+ * @brief shared access to an up to date index, re-indexes when the archive changed on disk since the last request
+ */
+static auto acquire( served_archive_t& archive ) -> std::shared_lock< std::shared_mutex >
+{
+	std::error_code ec{};
+
+	const auto time = std::filesystem::last_write_time( archive.m_path, ec );
+	const auto size = ec ? std::uintmax_t{} : std::filesystem::file_size( archive.m_path, ec );
+
+	if ( ec )
+		REZ_THROW( " - {:s}: {:s}", archive.m_path.string(), ec.message() );
+
+	//
+	// a close request may drop the index between the two locks, check again
+	//
+	while ( true )
+	{
+		{
+			std::shared_lock lock{ archive.m_mutex };
+
+			if ( archive.m_file && archive.m_time == time && archive.m_size == size )
+				return lock;
+		}
+
+		std::unique_lock lock{ archive.m_mutex };
+
+		if ( !archive.m_file || archive.m_time != time || archive.m_size != size )
+			reindex( archive, time, size );
+	}
+}
+
+static auto find( const served_archive_t& archive, const std::string_view path ) -> const served_resource_t*
+{
+	const auto key = normalize_path( path );
+
+	const auto it = std::lower_bound( archive.m_resources.begin(), archive.m_resources.end(), key, [] ( const served_resource_t& lhs, const std::string& rhs )
+	{
+		return lhs.m_key < rhs;
+	} );
+
+	if ( it == archive.m_resources.end() || it->m_key != key )
+		return nullptr;
+
+	return &*it;
+}
+
+/**
+ * @brief the resource named prefix and the resources under the directory prefix, "textures/a" doesn't match "textures/abc.dtx"
+ */
+static auto find_prefix( const served_archive_t& archive, const std::string_view prefix ) -> std::vector< const served_resource_t* >
+{
+	auto key = normalize_path( prefix );
+
+	while ( key.ends_with( '/' ) )
+		key.pop_back();
+
+	std::vector< const served_resource_t* > resources{};
+
+	if ( key.empty() )
+	{
+		for ( const auto& resource : archive.m_resources )
+			resources.emplace_back( &resource );
+
+		return resources;
+	}
+
+	if ( const auto resource = find( archive, key ) )
+		resources.emplace_back( resource );
+
+	//
+	// "key/" sorts after "key" and the names continuing it with a lower character ("key.dtx"), its entries are contiguous
+	//
+	key += '/';
+
+	const auto begin = std::lower_bound( archive.m_resources.begin(), archive.m_resources.end(), key, [] ( const served_resource_t& lhs, const std::string& rhs )
+	{
+		return lhs.m_key < rhs;
+	} );
+
+	for ( auto it = begin; it != archive.m_resources.end() && it->m_key.starts_with( key ); ++it )
+		resources.emplace_back( &*it );
+
+	return resources;
+}
+
+/**
+ * @brief pass the resource data to sink, the DTX header is converted on a copy since the mapping is read only
+ */
+template< typename F >
+static void emit( const served_archive_t& archive, const served_resource_t& resource, F&& sink )
+{
+	auto data = archive.m_file->view( resource.m_res.m_header.m_pos, resource.m_res.m_header.m_size );
+
+	if ( g_dtx_to_lithtech )
+	{
+		std::array< char, 0x10u > head{};
+
+		const auto size = std::min( data.size(), head.size() );
+
+		std::memcpy( head.data(), data.data(), size );
+
+		c_rez_file::convert_dtx( resource.m_res, head.data(), size );
+
+		sink( head.data(), size );
+
+		data.remove_prefix( size );
+	}
+
+	if ( !data.empty() )
+		sink( data.data(), data.size() );
+}
+
+class c_daemon
+{
+public:
+	c_daemon( const daemon_options_t& options ) :
+		m_options{ options },
+		m_listener{ INVALID_SOCKET },
+		m_wake_send{ INVALID_SOCKET },
+		m_wake_recv{ INVALID_SOCKET },
+		m_stop{ false },
+		m_pool{ nullptr }
+	{
+		for ( const auto& path : options.m_archives )
+		{
+			auto archive = std::make_unique< served_archive_t >();
+
+			archive->m_path = path;
+			archive->m_name = to_lower( path.filename().string() );
+
+			if ( this->archive( archive->m_name ) )
+				REZ_THROW( " - Archive served twice: {:s}", archive->m_name );
+
+			m_archives.emplace_back( std::move( archive ) );
+		}
+	}
+	~c_daemon()
+	{
+		for ( const auto socket : { m_wake_send, m_wake_recv, m_listener } )
+		{
+			if ( socket != INVALID_SOCKET )
+				::closesocket( socket );
+		}
+	}
+public:
+	void run()
+	{
+		//
+		// index up front so the first requests don't pay for it
+		//
+		for ( const auto& archive : m_archives )
+		{
+			try
+			{
+				acquire( *archive );
+			}
+			catch ( const std::exception& e )
+			{
+				log( "[ERROR] {:s}{:s}\n", archive->m_path.string(), e.what() );
+			}
+		}
+
+		const auto address = make_address( m_options.m_socket );
+
+		// left over by a daemon that didn't shut down
+		std::error_code ec{};
+		std::filesystem::remove( m_options.m_socket, ec );
+
+		m_listener = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+
+		if ( m_listener == INVALID_SOCKET )
+			REZ_THROW( " - socket: {:s}", std::system_category().message( ::WSAGetLastError() ) );
+
+		if ( ::bind( m_listener, reinterpret_cast< const sockaddr* >( &address ), sizeof( address ) ) == SOCKET_ERROR ||
+			::listen( m_listener, SOMAXCONN ) == SOCKET_ERROR )
+			REZ_THROW( " - bind: {:s}: {:s}", m_options.m_socket.string(), std::system_category().message( ::WSAGetLastError() ) );
+
+		log( "Serving {:d} archives on {:s}\n", m_archives.size(), m_options.m_socket.string() );
+
+		//
+		// a connection of our own wakes the poll, when a connection goes idle again and on shutdown
+		//
+		m_wake_send = connect_socket( m_options.m_socket );
+		m_wake_recv = ::accept( m_listener, nullptr, nullptr );
+
+		if ( m_wake_recv == INVALID_SOCKET )
+			REZ_THROW( " - accept: {:s}", std::system_category().message( ::WSAGetLastError() ) );
+
+		{
+			//
+			// idle connections wait in the poll, a worker only takes a connection for a single request
+			// so a client that holds its connection open doesn't keep a worker from the others
+			//
+			c_thread_pool pool{ m_options.m_threads };
+
+			m_pool = &pool;
+
+			std::vector< WSAPOLLFD > fds{};
+
+			while ( !m_stop )
+			{
+				fds.clear();
+				fds.push_back( { m_listener, POLLRDNORM, 0 } );
+				fds.push_back( { m_wake_recv, POLLRDNORM, 0 } );
+
+				{
+					std::scoped_lock lock{ m_mutex };
+
+					for ( const auto client : m_idle )
+						fds.push_back( { client, POLLRDNORM, 0 } );
+				}
+
+				if ( ::WSAPoll( fds.data(), static_cast< ULONG >( fds.size() ), -1 ) == SOCKET_ERROR )
+				{
+					log( "[ERROR] poll: {:s}\n", std::system_category().message( ::WSAGetLastError() ) );
+
+					continue;
+				}
+
+				if ( fds[ 1 ].revents )
+				{
+					std::array< char, 0x100u > data{};
+
+					::recv( m_wake_recv, data.data(), static_cast< int >( data.size() ), 0 );
+				}
+
+				if ( m_stop )
+					break;
+
+				if ( fds[ 0 ].revents )
+				{
+					const auto client = ::accept( m_listener, nullptr, nullptr );
+
+					if ( client == INVALID_SOCKET )
+					{
+						log( "[ERROR] accept: {:s}\n", std::system_category().message( ::WSAGetLastError() ) );
+					}
+					else
+					{
+						std::scoped_lock lock{ m_mutex };
+
+						m_connections.emplace( client, std::make_unique< c_connection >( client ) );
+						m_idle.insert( client );
+					}
+				}
+
+				//
+				// readable, closed or failed, the worker finds out which
+				//
+				for ( std::size_t i = 2u; i < fds.size(); ++i )
+				{
+					if ( !fds[ i ].revents )
+						continue;
+
+					{
+						std::scoped_lock lock{ m_mutex };
+
+						m_idle.erase( fds[ i ].fd );
+					}
+
+					this->dispatch( fds[ i ].fd );
+				}
+			}
+		}
+
+		m_pool = nullptr;
+
+		{
+			std::scoped_lock lock{ m_mutex };
+
+			for ( const auto& [client, connection] : m_connections )
+				::closesocket( client );
+
+			m_connections.clear();
+			m_idle.clear();
+		}
+
+		std::filesystem::remove( m_options.m_socket, ec );
+
+		log( "Daemon stopped\n" );
+	}
+private:
+	auto archive( const std::string_view name ) const -> served_archive_t*
+	{
+		const auto key = to_lower( std::string{ name } );
+
+		for ( const auto& archive : m_archives )
+		{
+			if ( archive->m_name == key )
+				return archive.get();
+		}
+
+		return nullptr;
+	}
+
+	void dispatch( const SOCKET socket )
+	{
+		m_pool->submit( [this, socket] { this->serve( socket ); } );
+	}
+
+	/**
+	 * @brief the next request already received goes straight back to the pool, otherwise the connection waits in the poll
+	 */
+	void release( const SOCKET socket, const c_connection& connection )
+	{
+		if ( m_stop )
+			return this->close( socket );
+
+		if ( connection.has_line() )
+			return this->dispatch( socket );
+
+		{
+			std::scoped_lock lock{ m_mutex };
+
+			m_idle.insert( socket );
+		}
+
+		this->wake();
+	}
+
+	void close( const SOCKET socket )
+	{
+		{
+			std::scoped_lock lock{ m_mutex };
+
+			m_connections.erase( socket );
+			m_idle.erase( socket );
+		}
+
+		::closesocket( socket );
+	}
+
+	void wake()
+	{
+		const char data = 0;
+
+		::send( m_wake_send, &data, 1, 0 );
+	}
+
+	/**
+	 * @brief a single request of the connection
+	 */
+	void serve( const SOCKET socket )
+	{
+		c_connection* connection = nullptr;
+
+		{
+			std::scoped_lock lock{ m_mutex };
+
+			connection = m_connections.at( socket ).get();
+		}
+
+		std::string line{};
+
+		try
+		{
+			if ( m_stop )
+				return this->close( socket );
+
+			if ( !connection->next_line( line ) )
+			{
+				if ( !connection->receive() )
+					return this->close( socket );
+
+				// only part of a line arrived
+				if ( !connection->next_line( line ) )
+					return this->release( socket, *connection );
+			}
+
+			std::vector< std::string_view > fields{};
+
+			for ( std::size_t begin = 0u; begin <= line.size(); )
+			{
+				const auto end = std::min( line.find( '\t', begin ), line.size() );
+
+				fields.emplace_back( std::string_view{ line }.substr( begin, end - begin ) );
+
+				begin = end + 1u;
+			}
+
+			//
+			// errors before the reply started are reported to the client, a failed send drops the connection
+			//
+			bool replied = false;
+
+			try
+			{
+				this->handle( *connection, fields, replied );
+			}
+			catch ( const std::exception& e )
+			{
+				if ( replied )
+					throw;
+
+				connection->reply_error( e.what() );
+			}
+		}
+		catch ( const std::exception& e )
+		{
+			log( "[ERROR] Connection: {:s}\n", e.what() );
+
+			return this->close( socket );
+		}
+
+		this->release( socket, *connection );
+	}
+
+	void handle( c_connection& connection, const std::vector< std::string_view >& fields, bool& replied )
+	{
+		const auto verb = fields.front();
+
+		auto expect = [&fields] ( const std::size_t min, const std::size_t max ) -> void
+		{
+			if ( fields.size() < min || fields.size() > max )
+				REZ_THROW( "Invalid arguments for {:s}", fields.front() );
+		};
+
+		auto served = [this, &fields] () -> served_archive_t&
+		{
+			const auto archive = this->archive( fields[ 1 ] );
+
+			if ( !archive )
+				REZ_THROW( "Unknown archive: {:s}", fields[ 1 ] );
+
+			return *archive;
+		};
+
+		if ( verb == "archives" )
+		{
+			expect( 1u, 1u );
+
+			std::string payload{};
+
+			for ( const auto& archive : m_archives )
+			{
+				std::shared_lock lock{ archive->m_mutex };
+
+				payload.append( std::format( "{:s}\t{:d}\t{:d}\n", archive->m_path.filename().string(), archive->m_size, archive->m_resources.size() ) );
+			}
+
+			connection.reply( payload );
+		}
+		else if ( verb == "list" )
+		{
+			expect( 2u, 3u );
+
+			auto& archive = served();
+
+			const auto lock = acquire( archive );
+
+			std::string payload{};
+
+			for ( const auto resource : find_prefix( archive, fields.size() > 2u ? fields[ 2 ] : std::string_view{} ) )
+				payload.append( std::format( "{:s}\t{:d}\t{:d}\n", resource->m_path, resource->m_res.m_header.m_size, resource->m_res.m_header.m_time ) );
+
+			connection.reply( payload );
+		}
+		else if ( verb == "stat" )
+		{
+			expect( 3u, 3u );
+
+			auto& archive = served();
+
+			const auto lock = acquire( archive );
+
+			const auto resource = find( archive, fields[ 2 ] );
+
+			if ( !resource )
+				REZ_THROW( "Not found: {:s}", fields[ 2 ] );
+
+			const auto& res = resource->m_res;
+
+			connection.reply( std::format( "{:s}\t{:d}\t{:d}\t{:d}\t{:d}\n", resource->m_path, res.m_header.m_size, res.m_header.m_time, res.m_id, res.m_header.m_pos ) );
+		}
+		else if ( verb == "read" )
+		{
+			expect( 3u, 3u );
+
+			auto& archive = served();
+
+			const auto lock = acquire( archive );
+
+			const auto resource = find( archive, fields[ 2 ] );
+
+			if ( !resource )
+				REZ_THROW( "Not found: {:s}", fields[ 2 ] );
+
+			// validates the range before anything is sent
+			archive.m_file->view( resource->m_res.m_header.m_pos, resource->m_res.m_header.m_size );
+
+			replied = true;
+
+			connection.send( std::format( "OK {:d}\n", resource->m_res.m_header.m_size ) );
+
+			emit( archive, *resource, [&connection] ( const char* data, const std::size_t size )
+			{
+				connection.send( data, size );
+			} );
+		}
+		else if ( verb == "extract" )
+		{
+			expect( 3u, 4u );
+
+			auto& archive = served();
+
+			const auto lock = acquire( archive );
+
+			const std::filesystem::path output{ fields[ 2 ] };
+
+			std::uint64_t count = 0u;
+			std::uint64_t bytes = 0u;
+
+			//
+			// same commit path as extract: written aside, renamed into place by the durability policy, throttled
+			//
+			c_commit_queue commits{};
+
+			try
+			{
+				for ( const auto resource : find_prefix( archive, fields.size() > 3u ? fields[ 3 ] : std::string_view{} ) )
+				{
+					const auto path = output / std::filesystem::path{ resource->m_path };
+
+					auto part = path;
+
+					part += ".part";
+
+					std::filesystem::create_directories( path.parent_path() );
+
+					try
+					{
+						commits.claim( path );
+
+						g_throttle.create();
+
+						{
+							c_writer out{ part, g_sparse };
+
+							emit( archive, *resource, [&out] ( const char* data, const std::size_t size )
+							{
+								g_throttle.read( size );
+								g_throttle.write( size );
+
+								out.write( data, size );
+							} );
+
+							out.finish();
+						}
+
+						commits.add( part, path, resource->m_res.m_header.m_size );
+					}
+					catch ( ... )
+					{
+						std::error_code ec{};
+
+						std::filesystem::remove( part, ec );
+
+						throw;
+					}
+
+					++count;
+					bytes += resource->m_res.m_header.m_size;
+				}
+			}
+			catch ( ... )
+			{
+				// what was written before the failure still gets its name
+				commits.finish();
+
+				throw;
+			}
+
+			commits.finish();
+
+			if ( const auto failed = commits.stats().m_failed )
+				REZ_THROW( " - {:d} of {:d} files couldn't be committed", failed, count );
+
+			connection.reply( std::format( "{:d}\t{:d}\n", count, bytes ) );
+		}
+		else if ( verb == "close" )
+		{
+			expect( 2u, 2u );
+
+			auto& archive = served();
+
+			//
+			// drop the mapping so the archive can be truncated or replaced, the next request re-indexes it
+			//
+			{
+				std::unique_lock lock{ archive.m_mutex };
+
+				archive.m_file.reset();
+				archive.m_resources.clear();
+			}
+
+			connection.reply( {} );
+		}
+		else if ( verb == "shutdown" )
+		{
+			expect( 1u, 1u );
+
+			connection.reply( {} );
+
+			m_stop = true;
+
+			this->wake();
+		}
+		else
+		{
+			REZ_THROW( "Unknown request: {:s}", verb );
+		}
+	}
+private:
+	const daemon_options_t&                                       m_options;
+	std::vector< std::unique_ptr< served_archive_t > >            m_archives{};
+
+	SOCKET                                                        m_listener;
+	SOCKET                                                        m_wake_send;
+	SOCKET                                                        m_wake_recv;
+	std::atomic< bool >                                           m_stop;
+
+	c_thread_pool*                                                m_pool;
+
+	// connections are only touched by the worker serving their request
+	std::mutex                                                    m_mutex;
+	std::unordered_map< SOCKET, std::unique_ptr< c_connection > > m_connections{};
+	std::unordered_set< SOCKET >                                  m_idle{};
+};
+
+}
+
+void rez::run_daemon( const daemon_options_t& options )
+{
+	c_winsock winsock{};
+
+	c_daemon daemon{ options };
+
+	daemon.run();
+}
+
+auto rez::request_daemon( const std::filesystem::path& socket, const std::string_view request, std::string& payload ) -> bool
+{
+	c_winsock winsock{};
+
+	const auto client = connect_socket( socket );
+
+	struct close_t
+	{
+		SOCKET m_socket;
+
+		~close_t() { ::closesocket( m_socket ); }
+	} close{ client };
+
+	c_connection connection{ client };
+
+	connection.send( request );
+	connection.send( "\n" );
+
+	std::string line{};
+
+	if ( !connection.read_line( line ) )
+		REZ_THROW( " - Connection closed by the daemon" );
+
+	if ( line.starts_with( "ERR " ) )
+	{
+		payload = line.substr( 4u );
+
+		return false;
+	}
+
+	if ( !line.starts_with( "OK " ) )
+		REZ_THROW( " - Invalid reply: {:s}", line );
+
+	const auto size = c_arguments::parse< std::uint64_t >( "reply size", std::string_view{ line }.substr( 3u ) );
+
+	if ( !connection.read( payload, static_cast< std::size_t >( size ) ) )
+		REZ_THROW( " - Connection closed by the daemon" );
+
+	return true;
+}
@@ -0,0 +1,323 @@
+#include "pch.hpp"
+#include "durability.hpp"
+
+#include "writer.hpp"
+
+namespace rez
+{
+
+static void move_file( const std::filesystem::path& from, const std::filesystem::path& to, const DWORD flags )
+{
+	if ( !::MoveFileExW( from.wstring().data(), to.wstring().data(), MOVEFILE_REPLACE_EXISTING | flags ) )
+		REZ_THROW( " - MoveFileEx: {:s}: {:s}", to.string(), std::system_category().message( ::GetLastError() ) );
+}
+
+/**
+ * @brief write the cached data of a closed file to the disk
+ */
+static void flush_file( const std::filesystem::path& path )
+{
+	const auto file = ::CreateFileW(
+		path.wstring().data(),
+		GENERIC_WRITE,
+		FILE_SHARE_READ | FILE_SHARE_WRITE,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr
+	);
+
+	if ( file == INVALID_HANDLE_VALUE )
+		REZ_THROW( " - CreateFile: {:s}: {:s}", path.string(), std::system_category().message( ::GetLastError() ) );
+
+	const auto flushed = ::FlushFileBuffers( file );
+	const auto error   = ::GetLastError();
+
+	::CloseHandle( file );
+
+	if ( !flushed )
+		REZ_THROW( " - FlushFileBuffers: {:s}: {:s}", path.string(), std::system_category().message( error ) );
+}
+
+/**
+ * @brief persist the entries of a directory (the renames)
+ */
+static void flush_directory( const std::filesystem::path& path )
+{
+	const auto directory = ::CreateFileW(
+		path.wstring().data(),
+		GENERIC_WRITE,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS,
+		nullptr
+	);
+
+	if ( directory == INVALID_HANDLE_VALUE )
+		REZ_THROW( " - CreateFile: {:s}: {:s}", path.string(), std::system_category().message( ::GetLastError() ) );
+
+	const auto flushed = ::FlushFileBuffers( directory );
+	const auto error   = ::GetLastError();
+
+	::CloseHandle( directory );
+
+	if ( !flushed )
+		REZ_THROW( " - FlushFileBuffers: {:s}: {:s}", path.string(), std::system_category().message( error ) );
+}
+
+}
+
+auto rez::parse_durability( const std::string_view value ) -> durability_
+{
+	for ( const auto mode : { durability_none, durability_batched, durability_strict } )
+	{
+		if ( value == durability_name( mode ) )
+			return mode;
+	}
+
+	REZ_THROW( "Invalid value for --durability: {:s} (none, batched or strict)", value );
+}
+
+auto rez::durability_name( const durability_ mode ) -> std::string_view
+{
+	switch ( mode )
+	{
+	case durability_batched: return "batched";
+	case durability_strict:  return "strict";
+	default:                 return "none";
+	}
+}
+
+void rez::c_commit_queue::add( const std::filesystem::path& part, const std::filesystem::path& file, const std::uint64_t bytes, std::function< void() > done )
+{
+	++m_stats.m_files;
+
+	if ( m_durability.m_mode != durability_batched )
+	{
+		// a single file, the caller reports it
+		try
+		{
+			if ( m_durability.m_mode == durability_strict )
+			{
+				const auto start = std::chrono::steady_clock::now();
+
+				// the rename only returns once it's on the disk as well, then its directory entry
+				flush_file( part );
+				move_file( part, file, MOVEFILE_WRITE_THROUGH );
+				flush_directory( file.parent_path() );
+
+				++m_stats.m_batches;
+
+				m_stats.m_flush_seconds += std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+			}
+			else
+			{
+				move_file( part, file, 0u );
+			}
+		}
+		catch ( ... )
+		{
+			++m_stats.m_failed;
+			throw;
+		}
+
+		if ( done )
+			done();
+
+		return;
+	}
+
+	this->claim( file );
+
+	m_pending.emplace_back( pending_t{ part, file, std::move( done ) } );
+	m_pending_names.emplace( pending_name( file ) );
+	m_pending_bytes += bytes;
+
+	if ( m_pending.size() >= m_durability.m_batch_files || m_pending_bytes >= m_durability.m_batch_bytes )
+		this->commit();
+}
+
+void rez::c_commit_queue::claim( const std::filesystem::path& file )
+{
+	if ( m_pending_names.contains( pending_name( file ) ) )
+		this->commit();
+}
+
+void rez::c_commit_queue::finish()
+{
+	this->commit();
+}
+
+auto rez::c_commit_queue::pending_name( const std::filesystem::path& file ) -> std::string
+{
+	// NTFS ignores the case, "Foo.dtx" and "foo.dtx" are the same file
+	return to_lower( file.generic_string() );
+}
+
+void rez::c_commit_queue::commit()
+{
+	if ( m_pending.empty() )
+		return;
+
+	auto batch = std::exchange( m_pending, {} );
+
+	m_pending_names.clear();
+	m_pending_bytes = 0u;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	//
+	// a failed file is reported and left out, the rest of the batch is still committed
+	//
+	const auto drop = [this] ( pending_t& pending, const std::exception& e )
+	{
+		std::error_code ec{};
+
+		std::filesystem::remove( pending.m_part, ec );
+
+		log( "{:s}\n", e.what() );
+
+		pending.m_part.clear();
+
+		++m_stats.m_failed;
+	};
+
+	//
+	// data first, then the names: a name never points at data that isn't on the disk yet
+	//
+	for ( auto& pending : batch )
+	{
+		try
+		{
+			flush_file( pending.m_part );
+		}
+		catch ( const std::exception& e )
+		{
+			drop( pending, e );
+		}
+	}
+
+	std::vector< std::filesystem::path > directories{};
+
+	for ( auto& pending : batch )
+	{
+		if ( pending.m_part.empty() )
+			continue;
+
+		try
+		{
+			move_file( pending.m_part, pending.m_file, 0u );
+
+			directories.emplace_back( pending.m_file.parent_path() );
+		}
+		catch ( const std::exception& e )
+		{
+			drop( pending, e );
+		}
+	}
+
+	std::sort( directories.begin(), directories.end() );
+
+	directories.erase( std::unique( directories.begin(), directories.end() ), directories.end() );
+
+	//
+	// a file whose directory isn't flushed is in place but not durable: not recorded, a resume writes it again
+	//
+	std::vector< std::filesystem::path > unflushed{};
+
+	for ( const auto& directory : directories )
+	{
+		try
+		{
+			flush_directory( directory );
+		}
+		catch ( const std::exception& e )
+		{
+			log( "{:s}\n", e.what() );
+
+			unflushed.emplace_back( directory );
+		}
+	}
+
+	for ( auto& pending : batch )
+	{
+		if ( pending.m_part.empty() || !std::binary_search( unflushed.begin(), unflushed.end(), pending.m_file.parent_path() ) )
+			continue;
+
+		pending.m_part.clear();
+
+		++m_stats.m_failed;
+	}
+
+	++m_stats.m_batches;
+
+	m_stats.m_flush_seconds += std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+
+	for ( const auto& pending : batch )
+	{
+		if ( !pending.m_part.empty() && pending.m_done )
+			pending.m_done();
+	}
+}
+
+auto rez::bench_durability( const std::filesystem::path& directory, const std::size_t files, const std::uint32_t file_size, const durability_t& durability ) -> std::vector< durability_bench_t >
+{
+	// not all zero, nothing may skip the writes
+	std::vector< char > data( file_size, '\0' );
+
+	for ( std::size_t i = 0u; i < data.size(); ++i )
+		data[ i ] = static_cast< char >( i * 31u + 7u );
+
+	std::vector< durability_bench_t > results{};
+
+	for ( const auto mode : { durability_none, durability_batched, durability_strict } )
+	{
+		const auto path = directory / std::format( "durability-{:s}", durability_name( mode ) );
+
+		std::filesystem::create_directories( path );
+
+		auto settings = durability;
+
+		settings.m_mode = mode;
+
+		c_commit_queue commits{ settings };
+
+		const auto start = std::chrono::steady_clock::now();
+
+		for ( std::size_t i = 0u; i < files; ++i )
+		{
+			const auto file = path / std::format( "{:d}.bin", i );
+
+			auto part = file;
+
+			part += ".part";
+
+			{
+				c_writer out{ part };
+
+				out.write( data.data(), data.size() );
+				out.finish();
+			}
+
+			commits.add( part, file, data.size() );
+		}
+
+		commits.finish();
+
+		const auto seconds = std::max( std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count(), 1e-6 );
+
+		results.emplace_back( durability_bench_t{
+			mode,
+			seconds,
+			static_cast< double >( files ) / seconds,
+			static_cast< double >( files ) * static_cast< double >( file_size ) / seconds
+		} );
+
+		std::error_code ec{};
+
+		std::filesystem::remove_all( path, ec );
+	}
+
+	return results;
+}
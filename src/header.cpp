@@ -0,0 +1,142 @@
+#include "pch.hpp"
+#include "header.hpp"
+
+namespace rez
+{
+
+static void decode( rez_header_t& header, const std::span< const header_field_t > fields, const std::span< const char > data )
+{
+	for ( const auto& field : fields )
+	{
+		const auto value = data.data() + field.m_offset;
+
+		std::visit( [&] ( const auto member ) -> void
+		{
+			using member_t = std::remove_cvref_t< decltype( header.*member ) >;
+
+			if constexpr ( std::is_same_v< member_t, std::string > )
+			{
+				std::string_view text{ value, field.m_size };
+
+				if ( field.m_pad == '\0' )
+					text = text.substr( 0u, std::min( text.find( '\0' ), text.size() ) );
+				else
+					text = text.substr( 0u, text.find_last_not_of( field.m_pad ) + 1u );
+
+				header.*member = text;
+			}
+			else
+			{
+				header.*member = load_le< member_t >( value );
+
+				if constexpr ( std::is_same_v< member_t, char > )
+				{
+					if ( !field.m_accept.empty() && field.m_accept.find( header.*member ) == std::string_view::npos )
+						REZ_THROW( " - Invalid {:s}", field.m_name );
+				}
+			}
+		}, field.m_member );
+	}
+}
+
+}
+
+void rez::validate_encoded_header( const rez_header_t& header )
+{
+	// head = 1, detect_head = 16
+	// 1 ^ 17 = 16
+	if ( header.m_detect_head != ( header.m_head ^ 0x11 ) )
+	{
+		REZ_THROW(
+			" - Invalid head (Head: {:d} | Detect: {:d} | Xor: {:d})",
+			header.m_head,
+			header.m_detect_head,
+			( header.m_head ^ 0x11 )
+		);
+	}
+
+	std::array< char, 32u + 1u > detect_encode{};
+
+	std::to_chars(
+		detect_encode.data(),
+		detect_encode.data() + header.m_detect_encode.size(),
+		std::atol( header.m_encode.data() ) ^ 0x16B4423 /*magic number*/
+	);
+
+	if ( header.m_detect_encode != detect_encode.data() )
+	{
+		REZ_THROW(
+			" - Invalid encode (Encode: {:s} | Detect: {:s} | Xor: {:s})",
+			header.m_encode,
+			header.m_detect_encode,
+			detect_encode.data()
+		);
+	}
+
+	// tail = 16, m_detect_tail = 1
+	// 16 ^ 17 = 1
+	if ( header.m_detect_tail != ( header.m_tail ^ 0x11 ) )
+	{
+		REZ_THROW(
+			" - Invalid tail (Tail: {:d} | Detect: {:d} | Xor: {:d})",
+			header.m_tail,
+			header.m_detect_tail, ( header.m_tail ^ 0x11 )
+		);
+	}
+}
+
+auto rez::parse_header( const std::span< const char > data ) -> rez_header_t
+{
+	if ( data.size() < HEADER_PREFIX_SIZE )
+		REZ_THROW( " - Invalid header size (Expected: {:d} | Current: {:d})", HEADER_PREFIX_SIZE, data.size() );
+
+	rez_header_t header{};
+
+	decode( header, HEADER_PREFIX, data );
+
+	//
+	// eof1 and the version tell the variants apart
+	//
+	const header_layout_t* last = nullptr;
+
+	for ( const auto& layout : HEADER_LAYOUTS )
+	{
+		if ( layout.m_eof != header.m_eof1 )
+			continue;
+
+		last = &layout;
+
+		if ( data.size() < layout.size() || load_le< std::uint32_t >( data.data() + layout.m_version_pos ) != layout.m_version )
+			continue;
+
+		decode( header, layout.m_fields, data );
+
+		if ( layout.m_validate )
+			layout.m_validate( header );
+
+		return header;
+	}
+
+	if ( !last )
+		REZ_THROW( " - Invalid eof1" );
+
+	if ( data.size() < last->size() )
+		REZ_THROW( " - Invalid header size (Expected: {:d} | Current: {:d})", last->size(), data.size() );
+
+	REZ_THROW(
+		" - Invalid file format version (Expected: {:d} | Current: {:d})",
+		last->m_version,
+		load_le< std::uint32_t >( data.data() + last->m_version_pos )
+	);
+}
+
+auto rez::header_layout( const rez_header_t& header ) -> const header_layout_t&
+{
+	for ( const auto& layout : HEADER_LAYOUTS )
+	{
+		if ( layout.m_eof == header.m_eof1 && layout.m_version == header.m_file_format_version )
+			return layout;
+	}
+
+	REZ_THROW( " - Unknown header layout (Eof: {:d} | Version: {:d})", header.m_eof1, header.m_file_format_version );
+}
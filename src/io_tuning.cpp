@@ -0,0 +1,173 @@
+#include "pch.hpp"
+#include "io_tuning.hpp"
+
+#include "buffer_pool.hpp"
+#include "rez.hpp"
+
+namespace rez
+{
+
+//
+// bytes written by a single trial
+//
+static constexpr std::size_t CALIBRATION_SIZE = 0x2000000u; // 32M
+
+/**
+ * @brief unbuffered write-through writes, the device is measured instead of the cache
+ * @return MB/s
+ */
+static auto measure( const std::filesystem::path& output, const std::size_t chunk_size, const std::size_t concurrency ) -> double
+{
+	auto& pool = shared_buffer_pool();
+
+	const auto per_thread = CALIBRATION_SIZE / concurrency;
+
+	std::vector< std::thread > threads{};
+	std::atomic< bool >        failed{ false };
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for ( std::size_t i = 0u; i < concurrency; ++i )
+	{
+		threads.emplace_back( [&, i]
+		{
+			const auto path = output / std::format( ".rezextract-calibration-{:d}", i );
+
+			const auto file = ::CreateFileW(
+				path.wstring().data(),
+				GENERIC_WRITE,
+				0u,
+				nullptr,
+				CREATE_ALWAYS,
+				FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH,
+				nullptr
+			);
+
+			if ( file == INVALID_HANDLE_VALUE )
+			{
+				failed = true;
+
+				return;
+			}
+
+			// page aligned and a multiple of the sector size
+			const auto buffer = pool.acquire( chunk_size );
+
+			std::memset( buffer.data(), 0xCD, buffer.size() );
+
+			for ( std::size_t written = 0u; written < per_thread; written += chunk_size )
+			{
+				DWORD size = 0u;
+
+				if ( !::WriteFile( file, buffer.data(), static_cast< DWORD >( chunk_size ), &size, nullptr ) || size != chunk_size )
+				{
+					failed = true;
+
+					break;
+				}
+			}
+
+			::CloseHandle( file );
+
+			std::error_code ec{};
+
+			std::filesystem::remove( path, ec );
+		} );
+	}
+
+	for ( auto& thread : threads )
+		thread.join();
+
+	if ( failed )
+		return 0.0;
+
+	const auto elapsed = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+
+	return static_cast< double >( CALIBRATION_SIZE ) / 1048576.0 / std::max( elapsed, 1e-6 );
+}
+
+}
+
+auto rez::calibrate( const std::filesystem::path& output, const io_tuning_t& current, const io_fixed_t& fixed ) -> std::optional< io_tuning_t >
+{
+	static constexpr std::array< std::size_t, 4u > CHUNK_SIZES  = { 0x10000u, 0x40000u, 0x100000u, 0x400000u };
+	static constexpr std::array< std::size_t, 4u > CONCURRENCY  = { 1u, 2u, 4u, 8u };
+	static constexpr double                        MIN_GAIN     = 1.1;
+
+	if ( fixed.m_chunk_size && fixed.m_concurrency )
+	{
+		log( " - Calibration: nothing to measure, --chunk-size and --parallel-chunks are set\n" );
+
+		return current;
+	}
+
+	auto tuning = current;
+
+	// a single writer unless more are measurably faster
+	if ( !fixed.m_concurrency )
+		tuning.m_concurrency = 1u;
+
+	double best = 0.0;
+
+	if ( fixed.m_chunk_size )
+	{
+		// the baseline the writer counts are compared with
+		best = measure( output, tuning.m_chunk_size, tuning.m_concurrency );
+	}
+	else
+	{
+		for ( const auto chunk_size : CHUNK_SIZES )
+		{
+			const auto speed = measure( output, chunk_size, tuning.m_concurrency );
+
+			log( " - Calibration: chunk {:d}K: {:.1f} MB/s\n", chunk_size >> 10u, speed );
+
+			if ( speed > best * MIN_GAIN )
+			{
+				best                = speed;
+				tuning.m_chunk_size = chunk_size;
+			}
+		}
+	}
+
+	const auto cores = std::max< std::size_t >( std::thread::hardware_concurrency(), 1u );
+
+	for ( const auto concurrency : CONCURRENCY )
+	{
+		if ( fixed.m_concurrency || concurrency == 1u || concurrency > cores )
+			continue;
+
+		const auto speed = measure( output, tuning.m_chunk_size, concurrency );
+
+		log( " - Calibration: {:d} writers: {:.1f} MB/s\n", concurrency, speed );
+
+		if ( speed > best * MIN_GAIN )
+		{
+			best                 = speed;
+			tuning.m_concurrency = concurrency;
+		}
+	}
+
+	if ( best == 0.0 )
+		return std::nullopt;
+
+	log( " - Calibration: chunk {:d}K, {:d} writers ({:.1f} MB/s)\n", tuning.m_chunk_size >> 10u, tuning.m_concurrency, best );
+
+	return tuning;
+}
+
+void rez::tune_io( const std::filesystem::path& output )
+{
+	static bool calibrated = false;
+
+	if ( !g_calibrate || calibrated )
+		return;
+
+	calibrated = true;
+
+	// the threshold isn't measured, the explicit settings are kept
+	if ( const auto tuning = calibrate( output, g_io_tuning, g_io_fixed ) )
+		g_io_tuning = *tuning;
+	else
+		log( " - Calibration failed, keeping chunk {:d}K, {:d} writers\n", g_io_tuning.m_chunk_size >> 10u, g_io_tuning.m_concurrency );
+}
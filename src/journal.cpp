@@ -0,0 +1,149 @@
+#include "pch.hpp"
+#include "journal.hpp"
+
+#include "rez.hpp"
+#include "rez_file.hpp"
+
+namespace rez
+{
+
+static constexpr std::size_t JOURNAL_RECORD = 24u;
+
+static auto record_key( const std::size_t dir, const std::size_t res ) -> std::uint64_t
+{
+	return ( static_cast< std::uint64_t >( dir ) << 32u ) | static_cast< std::uint32_t >( res );
+}
+
+static auto encode_record( const std::uint64_t archive, const std::size_t dir, const std::size_t res ) -> std::array< char, JOURNAL_RECORD >
+{
+	std::array< char, JOURNAL_RECORD > record{};
+
+	store_le( record.data() + 0x00u, archive );
+	store_le( record.data() + 0x08u, static_cast< std::uint32_t >( dir ) );
+	store_le( record.data() + 0x0Cu, static_cast< std::uint32_t >( res ) );
+	store_le( record.data() + 0x10u, fnv1a( record.data(), 0x10u ) );
+
+	return record;
+}
+
+}
+
+rez::c_journal::c_journal( const std::filesystem::path& output ) :
+	m_path{ output / filename() },
+	m_file{ INVALID_HANDLE_VALUE }
+{
+	//
+	// load the valid records, everything after the first bad one is a torn append
+	//
+	std::uint64_t valid = 0u;
+
+	{
+		std::ifstream in{ m_path, std::ios::binary };
+
+		std::array< char, JOURNAL_RECORD > record{};
+
+		while ( in && in.read( record.data(), record.size() ) )
+		{
+			if ( load_le< std::uint64_t >( record.data() + 0x10u ) != fnv1a( record.data(), 0x10u ) )
+				break;
+
+			const auto archive = load_le< std::uint64_t >( record.data() );
+			const auto dir     = load_le< std::uint32_t >( record.data() + 0x08u );
+			const auto res     = load_le< std::uint32_t >( record.data() + 0x0Cu );
+
+			m_done[ archive ].emplace( record_key( dir, res ) );
+
+			valid += record.size();
+		}
+	}
+
+	m_file = ::CreateFileW(
+		m_path.wstring().data(),
+		GENERIC_WRITE,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr
+	);
+
+	if ( m_file == INVALID_HANDLE_VALUE )
+		REZ_THROW( " - CreateFile: {:s}: {:s}", m_path.string(), std::system_category().message( ::GetLastError() ) );
+
+	//
+	// cut the torn tail and append after the last valid record
+	//
+	LARGE_INTEGER pos{};
+
+	pos.QuadPart = static_cast< LONGLONG >( valid );
+
+	if ( !::SetFilePointerEx( m_file, pos, nullptr, FILE_BEGIN ) || !::SetEndOfFile( m_file ) )
+	{
+		const auto error = ::GetLastError();
+
+		::CloseHandle( m_file );
+
+		REZ_THROW( " - SetEndOfFile: {:s}: {:s}", m_path.string(), std::system_category().message( error ) );
+	}
+}
+
+rez::c_journal::~c_journal()
+{
+	if ( m_file != INVALID_HANDLE_VALUE )
+		::CloseHandle( m_file );
+}
+
+auto rez::c_journal::filename() -> std::string
+{
+	if ( g_shard_count > 1u )
+		return std::format( ".rezextract.{:d}.journal", g_shard_index );
+
+	return ".rezextract.journal";
+}
+
+auto rez::c_journal::archive_id( const c_rez_file& rez ) -> std::uint64_t
+{
+	//
+	// the records hold resource indices, an index built another way (i.e salvaged) numbers them differently
+	//
+	const std::array< std::uint8_t, 2u > options =
+	{
+		static_cast< std::uint8_t >( g_dtx_to_lithtech ? 1u : 0u ),
+		static_cast< std::uint8_t >( rez.index_source() )
+	};
+
+	return fnv1a( options.data(), options.size(), rez.fingerprint() );
+}
+
+auto rez::c_journal::done( const std::uint64_t archive, const std::size_t dir, const std::size_t res ) const -> bool
+{
+	std::scoped_lock lock{ m_mutex };
+
+	const auto it = m_done.find( archive );
+
+	return it != m_done.end() && it->second.contains( record_key( dir, res ) );
+}
+
+void rez::c_journal::complete( const std::uint64_t archive, const std::size_t dir, const std::size_t res )
+{
+	const auto record = encode_record( archive, dir, res );
+
+	std::scoped_lock lock{ m_mutex };
+
+	// a single write per record, the file pointer stays on a record boundary
+	DWORD written = 0u;
+
+	if ( !::WriteFile( m_file, record.data(), static_cast< DWORD >( record.size() ), &written, nullptr ) || written != record.size() )
+		REZ_THROW( " - WriteFile: {:s}: {:s}", m_path.string(), std::system_category().message( ::GetLastError() ) );
+
+	m_done[ archive ].emplace( record_key( dir, res ) );
+}
+
+auto rez::c_journal::count( const std::uint64_t archive ) const -> std::size_t
+{
+	std::scoped_lock lock{ m_mutex };
+
+	const auto it = m_done.find( archive );
+
+	return it != m_done.end() ? it->second.size() : 0u;
+}
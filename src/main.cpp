@@ -1,4 +1,5 @@
 #include "pch.hpp"
+#include "commands.hpp"
 #include "file_dialog.hpp"
 #include "rez.hpp"
 
@@ -7,8 +8,21 @@ static constexpr std::string_view SELECT_FILES_FILTER = "REZ File (*.rez)\0*.rez
 
 static constexpr std::wstring_view SAVE_PATH_TITLE    = L"Extract files into . . .";
 
-int main( )
+int main( int argc, char* argv[] )
 {
+	//
+	// command line mode
+	//
+	if ( argc > 1 )
+	{
+		rez::g_interactive = false;
+
+		if ( !std::setlocale( LC_ALL, "" ) )
+			rez::log( "Failed to copy locale\n" );
+
+		return rez::cmd::run( std::vector< std::string_view >( argv + 1, argv + argc ) );
+	}
+
 	try
 	{
 		if ( !std::setlocale( LC_ALL, "" ) )
@@ -55,7 +69,29 @@ int main( )
 
 		rez::g_dtx_to_lithtech = ( res == IDYES );
 
-		rez::extract( file_path, save_path );
+		bool overlay = false;
+
+		if ( file_path.size() > 1u )
+		{
+			overlay = ::MessageBoxA(
+				::GetConsoleWindow(),
+				"Merge the archives? Files in later archives (by name) override files with the same path.",
+				"Overlay",
+				MB_YESNO | MB_ICONQUESTION
+			) == IDYES;
+		}
+
+		if ( overlay )
+		{
+			// the dialog does not keep the selection order, layer by file name
+			std::sort( file_path.begin(), file_path.end() );
+
+			rez::extract_overlay( file_path, save_path, true );
+		}
+		else
+		{
+			rez::extract( file_path, save_path );
+		}
 	}
 	catch ( const std::exception& e )
 	{
@@ -0,0 +1,550 @@
+#include "pch.hpp"
+#include "name_index.hpp"
+
+#include "rez_file.hpp"
+#include "thread_pool.hpp"
+
+namespace rez
+{
+
+struct name_index_header_t
+{
+	std::array< char, 4u > m_magic{};
+	std::uint32_t          m_version{};
+	std::uint64_t          m_fingerprint{};
+	std::uint32_t          m_entry_count{};
+	std::uint32_t          m_trigram_count{};
+	std::uint64_t          m_posting_count{};
+	std::uint64_t          m_strings_size{};
+};
+
+struct name_index_trigram_t
+{
+	std::uint32_t m_trigram{};
+	std::uint32_t m_count{}; // entries, stored back to back in trigram order after the table
+};
+
+static constexpr std::array< char, 4u > NAME_INDEX_MAGIC   = { 'R', 'Z', 'I', '1' };
+static constexpr std::uint32_t          NAME_INDEX_VERSION = 1u;
+
+static_assert( sizeof( name_index_header_t ) == 40u );
+static_assert( sizeof( name_entry_t ) == 24u );
+
+static auto lower( const char ch ) -> char
+{
+	return static_cast< char >( std::tolower( static_cast< unsigned char >( ch ) ) );
+}
+
+static auto trigram( const char* text ) -> std::uint32_t
+{
+	return ( static_cast< std::uint32_t >( static_cast< unsigned char >( text[ 0u ] ) ) << 16u ) |
+		( static_cast< std::uint32_t >( static_cast< unsigned char >( text[ 1u ] ) ) << 8u ) |
+		static_cast< std::uint32_t >( static_cast< unsigned char >( text[ 2u ] ) );
+}
+
+/**
+ * @brief distinct trigrams of an already lowercased text
+ */
+static void append_trigrams( const std::string_view text, std::vector< std::uint32_t >& trigrams )
+{
+	for ( std::size_t i = 0u; i + 3u <= text.size(); ++i )
+		trigrams.emplace_back( trigram( text.data() + i ) );
+}
+
+static void unique( std::vector< std::uint32_t >& values )
+{
+	std::sort( values.begin(), values.end() );
+
+	values.erase( std::unique( values.begin(), values.end() ), values.end() );
+}
+
+template< typename T >
+static void write_span( std::ofstream& out, const std::span< const T > values )
+{
+	out.write( reinterpret_cast< const char* >( values.data() ), static_cast< std::streamsize >( values.size_bytes() ) );
+}
+
+template< typename T >
+static void read_span( std::ifstream& in, const std::span< T > values )
+{
+	in.read( reinterpret_cast< char* >( values.data() ), static_cast< std::streamsize >( values.size_bytes() ) );
+}
+
+}
+
+auto rez::c_name_index::build( c_rez_file& rez ) -> c_name_index
+{
+	rez.read_index();
+
+	const auto& directories = rez.index().m_directories;
+
+	c_name_index index{};
+
+	index.m_archive     = rez.path();
+	index.m_fingerprint = rez.fingerprint();
+
+	for ( std::size_t d = 0u; d < directories.size(); ++d )
+	{
+		const auto directory = rez.directory_path( d );
+
+		for ( const auto& res : directories[ d ].m_resource )
+		{
+			const auto path = ( directory / c_rez_file::resource_filename( res ) ).generic_string();
+
+			//
+			// the entries hold 32 bit offsets and are numbered with 32 bits
+			//
+			constexpr std::uint64_t limit = std::numeric_limits< std::uint32_t >::max();
+
+			if ( index.m_strings.size() + path.size() + res.m_description.size() > limit || index.m_entries.size() >= limit )
+				REZ_THROW( " - Too many names to index (Entries: {:d} | Strings: {:d})", index.m_entries.size(), index.m_strings.size() );
+
+			name_entry_t entry{};
+
+			entry.m_path      = static_cast< std::uint32_t >( index.m_strings.size() );
+			entry.m_path_size = static_cast< std::uint32_t >( path.size() );
+
+			index.m_strings += path;
+
+			entry.m_desc      = static_cast< std::uint32_t >( index.m_strings.size() );
+			entry.m_desc_size = static_cast< std::uint32_t >( res.m_description.size() );
+
+			index.m_strings += res.m_description;
+
+			entry.m_size = res.m_header.m_size;
+			entry.m_time = res.m_header.m_time;
+
+			index.m_entries.emplace_back( entry );
+		}
+	}
+
+	index.lower_strings();
+
+	std::vector< std::uint32_t > scratch{};
+
+	for ( std::uint32_t i = 0u; i < index.m_entries.size(); ++i )
+		index.add_trigrams( i, scratch );
+
+	return index;
+}
+
+auto rez::c_name_index::index_path( const std::filesystem::path& archive ) -> std::filesystem::path
+{
+	auto path = archive;
+
+	path += EXTENSION;
+
+	return path;
+}
+
+auto rez::c_name_index::load( const std::filesystem::path& archive, const std::uint64_t fingerprint ) -> std::optional< c_name_index >
+{
+	const auto path = index_path( archive );
+
+	std::error_code ec{};
+
+	const auto file_size = std::filesystem::file_size( path, ec );
+
+	if ( ec )
+		return std::nullopt;
+
+	try
+	{
+		std::ifstream in{};
+		in.exceptions( std::ios::badbit | std::ios::failbit | std::ios::eofbit );
+		in.open( path, std::ios::binary );
+
+		name_index_header_t header{};
+
+		in.read( reinterpret_cast< char* >( &header ), sizeof( header ) );
+
+		if ( header.m_magic != NAME_INDEX_MAGIC || header.m_version != NAME_INDEX_VERSION || header.m_fingerprint != fingerprint )
+			return std::nullopt;
+
+		//
+		// the counts must add up to the file size before anything is allocated
+		//
+		const auto expected =
+			sizeof( header ) +
+			static_cast< std::uint64_t >( header.m_entry_count ) * sizeof( name_entry_t ) +
+			static_cast< std::uint64_t >( header.m_trigram_count ) * sizeof( name_index_trigram_t ) +
+			header.m_posting_count * sizeof( std::uint32_t ) +
+			header.m_strings_size;
+
+		if ( expected != file_size )
+			return std::nullopt;
+
+		c_name_index index{};
+
+		index.m_archive     = archive;
+		index.m_fingerprint = fingerprint;
+
+		index.m_entries.resize( header.m_entry_count );
+
+		read_span( in, std::span{ index.m_entries } );
+
+		std::vector< name_index_trigram_t > trigrams( header.m_trigram_count );
+
+		read_span( in, std::span{ trigrams } );
+
+		std::uint64_t postings = 0u;
+
+		for ( const auto& trigram : trigrams )
+		{
+			auto& entries = index.m_trigrams[ trigram.m_trigram ];
+
+			entries.resize( trigram.m_count );
+
+			read_span( in, std::span{ entries } );
+
+			postings += trigram.m_count;
+		}
+
+		index.m_strings.resize( static_cast< std::size_t >( header.m_strings_size ) );
+
+		if ( !index.m_strings.empty() )
+			in.read( index.m_strings.data(), static_cast< std::streamsize >( index.m_strings.size() ) );
+
+		if ( postings != header.m_posting_count )
+			return std::nullopt;
+
+		for ( const auto& entry : index.m_entries )
+		{
+			if ( static_cast< std::uint64_t >( entry.m_path ) + entry.m_path_size > index.m_strings.size() ||
+				static_cast< std::uint64_t >( entry.m_desc ) + entry.m_desc_size > index.m_strings.size() )
+				return std::nullopt;
+		}
+
+		for ( const auto& [trigram, entries] : index.m_trigrams )
+		{
+			if ( std::any_of( entries.begin(), entries.end(), [&] ( const std::uint32_t entry ) { return entry >= index.m_entries.size(); } ) )
+				return std::nullopt;
+		}
+
+		index.lower_strings();
+
+		return index;
+	}
+	catch ( const std::exception& )
+	{
+		// rebuilt by the caller
+		return std::nullopt;
+	}
+}
+
+void rez::c_name_index::save() const
+{
+	std::vector< std::uint32_t > keys{};
+
+	keys.reserve( m_trigrams.size() );
+
+	for ( const auto& [trigram, entries] : m_trigrams )
+		keys.emplace_back( trigram );
+
+	std::sort( keys.begin(), keys.end() );
+
+	std::vector< name_index_trigram_t > table{};
+
+	std::uint64_t postings = 0u;
+
+	for ( const auto key : keys )
+	{
+		const auto count = m_trigrams.at( key ).size();
+
+		table.emplace_back( name_index_trigram_t{ key, static_cast< std::uint32_t >( count ) } );
+
+		postings += count;
+	}
+
+	const name_index_header_t header{
+		NAME_INDEX_MAGIC,
+		NAME_INDEX_VERSION,
+		m_fingerprint,
+		static_cast< std::uint32_t >( m_entries.size() ),
+		static_cast< std::uint32_t >( table.size() ),
+		postings,
+		m_strings.size()
+	};
+
+	//
+	// written aside and renamed, a reader never sees half an index
+	//
+	const auto path = index_path( m_archive );
+
+	auto temp = path;
+
+	temp += ".tmp";
+
+	{
+		std::ofstream out{};
+		out.exceptions( std::ios::badbit | std::ios::failbit );
+		out.open( temp, std::ios::binary );
+
+		out.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+
+		write_span( out, std::span< const name_entry_t >{ m_entries } );
+		write_span( out, std::span< const name_index_trigram_t >{ table } );
+
+		for ( const auto key : keys )
+			write_span( out, std::span< const std::uint32_t >{ m_trigrams.at( key ) } );
+
+		out.write( m_strings.data(), static_cast< std::streamsize >( m_strings.size() ) );
+	}
+
+	std::filesystem::rename( temp, path );
+}
+
+void rez::c_name_index::find( const std::string_view query, const bool fuzzy, std::vector< name_hit_t >& hits ) const
+{
+	std::string needle( query.size(), '\0' );
+
+	std::transform( query.begin(), query.end(), needle.begin(), lower );
+
+	std::vector< std::uint32_t > trigrams{};
+
+	append_trigrams( needle, trigrams );
+	unique( trigrams );
+
+	auto matches = [&] ( const std::uint32_t index ) -> bool
+	{
+		const auto& entry = m_entries[ index ];
+
+		const std::string_view text{ m_lower };
+
+		return text.substr( entry.m_path, entry.m_path_size ).find( needle ) != std::string_view::npos ||
+			text.substr( entry.m_desc, entry.m_desc_size ).find( needle ) != std::string_view::npos;
+	};
+
+	//
+	// too short for a trigram, every entry is a candidate
+	//
+	if ( trigrams.empty() )
+	{
+		for ( std::uint32_t i = 0u; i < m_entries.size(); ++i )
+		{
+			if ( matches( i ) )
+				hits.emplace_back( name_hit_t{ this, i, 1.0 } );
+		}
+
+		return;
+	}
+
+	std::vector< const std::vector< std::uint32_t >* > lists{};
+
+	for ( const auto key : trigrams )
+	{
+		const auto it = m_trigrams.find( key );
+
+		if ( it != m_trigrams.end() )
+			lists.emplace_back( &it->second );
+		else if ( !fuzzy )
+			return;
+	}
+
+	if ( fuzzy )
+	{
+		//
+		// count the shared trigrams, a typo costs up to three of them: one typo always passes,
+		// a long query needs half of them
+		//
+		const auto count  = trigrams.size();
+		const auto needed = static_cast< std::uint16_t >( std::max< std::size_t >( std::min( count > 3u ? count - 3u : 0u, ( count + 1u ) / 2u ), 1u ) );
+
+		std::vector< std::uint16_t > counts( m_entries.size(), 0u );
+		std::vector< std::uint32_t > touched{};
+
+		for ( const auto list : lists )
+		{
+			for ( const auto index : *list )
+			{
+				if ( counts[ index ]++ == 0u )
+					touched.emplace_back( index );
+			}
+		}
+
+		for ( const auto index : touched )
+		{
+			if ( counts[ index ] >= needed )
+				hits.emplace_back( name_hit_t{ this, index, static_cast< double >( counts[ index ] ) / static_cast< double >( count ) } );
+		}
+
+		return;
+	}
+
+	//
+	// intersect from the shortest list, the candidates only shrink
+	//
+	std::sort( lists.begin(), lists.end(), [] ( const auto* lhs, const auto* rhs )
+	{
+		return lhs->size() < rhs->size();
+	} );
+
+	std::vector< std::uint32_t > candidates( lists.front()->begin(), lists.front()->end() );
+	std::vector< std::uint32_t > next{};
+
+	for ( std::size_t i = 1u; i < lists.size() && !candidates.empty(); ++i )
+	{
+		next.clear();
+
+		std::set_intersection( candidates.begin(), candidates.end(), lists[ i ]->begin(), lists[ i ]->end(), std::back_inserter( next ) );
+
+		candidates.swap( next );
+	}
+
+	// a trigram match isn't a substring match yet ("abcxbcd" holds "abc" and "bcd", not "abcd")
+	for ( const auto index : candidates )
+	{
+		if ( matches( index ) )
+			hits.emplace_back( name_hit_t{ this, index, 1.0 } );
+	}
+}
+
+auto rez::c_name_index::path( const std::uint32_t entry ) const -> std::string_view
+{
+	const auto& value = m_entries[ entry ];
+
+	return std::string_view{ m_strings }.substr( value.m_path, value.m_path_size );
+}
+
+auto rez::c_name_index::description( const std::uint32_t entry ) const -> std::string_view
+{
+	const auto& value = m_entries[ entry ];
+
+	return std::string_view{ m_strings }.substr( value.m_desc, value.m_desc_size );
+}
+
+void rez::c_name_index::add_trigrams( const std::uint32_t entry, std::vector< std::uint32_t >& scratch )
+{
+	const auto& value = m_entries[ entry ];
+
+	const std::string_view text{ m_lower };
+
+	scratch.clear();
+
+	// path and description apart, no trigram spans both
+	append_trigrams( text.substr( value.m_path, value.m_path_size ), scratch );
+	append_trigrams( text.substr( value.m_desc, value.m_desc_size ), scratch );
+
+	unique( scratch );
+
+	for ( const auto key : scratch )
+		m_trigrams[ key ].emplace_back( entry );
+}
+
+void rez::c_name_index::lower_strings()
+{
+	m_lower.resize( m_strings.size() );
+
+	std::transform( m_strings.begin(), m_strings.end(), m_lower.begin(), lower );
+}
+
+rez::c_name_search::c_name_search( const std::vector< std::filesystem::path >& file_path, const name_search_options_t& options )
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	c_thread_pool pool{ options.m_threads };
+
+	struct opened_t
+	{
+		std::optional< c_name_index > m_index{};
+		bool                          m_loaded{};
+	};
+
+	std::vector< std::future< opened_t > > pending{};
+
+	for ( const auto& file : file_path )
+	{
+		pending.emplace_back( pool.submit( [&file, &options] () -> opened_t
+		{
+			try
+			{
+				auto rez = c_rez_file{ file };
+
+				rez.load();
+
+				if ( !options.m_rebuild )
+				{
+					if ( auto index = c_name_index::load( file, rez.fingerprint() ) )
+						return { std::move( index ), true };
+				}
+
+				auto index = c_name_index::build( rez );
+
+				if ( options.m_save )
+					index.save();
+
+				return { std::move( index ), false };
+			}
+			catch ( const std::exception& e )
+			{
+				log( "[ERROR] {:s}: {:s}\n", file.string(), e.what() );
+
+				return {};
+			}
+		} ) );
+	}
+
+	for ( auto& opened : pending )
+	{
+		auto value = opened.get();
+
+		if ( !value.m_index )
+			continue;
+
+		if ( value.m_loaded )
+			++m_loaded;
+
+		m_indexes.emplace_back( std::move( *value.m_index ) );
+	}
+
+	m_seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+}
+
+auto rez::c_name_search::find( const std::string_view query, const bool fuzzy, const std::size_t limit ) const -> name_result_t
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	name_result_t result{};
+
+	for ( const auto& index : m_indexes )
+		index.find( query, fuzzy, result.m_hits );
+
+	result.m_total = result.m_hits.size();
+
+	//
+	// best score, then the shortest path: the closest to the query
+	//
+	auto better = [] ( const name_hit_t& lhs, const name_hit_t& rhs )
+	{
+		const auto lhs_path = lhs.m_index->path( lhs.m_entry );
+		const auto rhs_path = rhs.m_index->path( rhs.m_entry );
+
+		if ( lhs.m_score != rhs.m_score )
+			return lhs.m_score > rhs.m_score;
+
+		if ( lhs_path.size() != rhs_path.size() )
+			return lhs_path.size() < rhs_path.size();
+
+		return lhs_path < rhs_path;
+	};
+
+	const auto count = std::min( limit, result.m_hits.size() );
+
+	std::partial_sort( result.m_hits.begin(), result.m_hits.begin() + static_cast< std::ptrdiff_t >( count ), result.m_hits.end(), better );
+
+	result.m_hits.resize( count );
+
+	result.m_seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+
+	return result;
+}
+
+auto rez::c_name_search::entries() const -> std::size_t
+{
+	std::size_t count = 0u;
+
+	for ( const auto& index : m_indexes )
+		count += index.size();
+
+	return count;
+}
@@ -0,0 +1,159 @@
+#include "pch.hpp"
+#include "rez.hpp"
+
+#include "rez_file.hpp"
+
+#include "io_tuning.hpp"
+
+namespace rez
+{
+
+/**
+ * @brief archive that owns the last (winning) copy of a resource path
+ */
+struct overlay_entry_t
+{
+	std::size_t m_archive{};
+	std::size_t m_directory{};
+	std::size_t m_resource{};
+};
+
+}
+
+auto rez::extract_overlay( const std::vector<std::filesystem::path>& file_path, const std::filesystem::path& save_path, const bool report ) -> std::size_t
+{
+	std::vector< std::unique_ptr< c_rez_file > > archives = {};
+
+	std::size_t failed = 0u;
+
+	//
+	// load every archive index before writing anything
+	//
+	for ( const auto& file : file_path )
+	{
+		try
+		{
+			log( "Loading: {}\n", file.stem().string() );
+
+			auto rez = std::make_unique< c_rez_file >( file );
+
+			try
+			{
+				rez->load();
+				rez->read_index();
+			}
+			catch ( const std::exception& e )
+			{
+				if ( !g_salvage )
+					throw;
+
+				log( "{:s}\n - Salvaging\n", e.what() );
+
+				rez->salvage();
+			}
+
+			archives.emplace_back( std::move( rez ) );
+		}
+		catch ( const std::exception& e )
+		{
+			log( "[FATAL] {:s}\n", e.what() );
+			pause();
+
+			++failed;
+		}
+	}
+
+	//
+	// merged index, the last archive wins
+	//
+	std::unordered_map< std::string, overlay_entry_t > entries = {};
+
+	std::size_t shadowed = 0u;
+
+	for ( std::size_t a = 0u; a < archives.size(); ++a )
+	{
+		const auto& directories = archives[ a ]->index().m_directories;
+
+		for ( std::size_t d = 0u; d < directories.size(); ++d )
+		{
+			const auto dir_path = archives[ a ]->directory_path( d );
+
+			for ( std::size_t r = 0u; r < directories[ d ].m_resource.size(); ++r )
+			{
+				const auto path = dir_path / c_rez_file::resource_filename( directories[ d ].m_resource[ r ] );
+
+				const auto [it, inserted] = entries.try_emplace( to_lower( path.generic_string() ), overlay_entry_t{ a, d, r } );
+
+				if ( inserted )
+					continue;
+
+				if ( report )
+				{
+					log(
+						" - Shadowed: {:s} ({:s} -> {:s})\n",
+						path.generic_string(),
+						archives[ it->second.m_archive ]->path().filename().string(),
+						archives[ a ]->path().filename().string()
+					);
+				}
+
+				it->second = { a, d, r };
+
+				++shadowed;
+			}
+		}
+	}
+
+	log( "Overlay: {:d} resources, {:d} shadowed\n", entries.size(), shadowed );
+
+	tune_io( save_path );
+
+	//
+	// winners grouped by archive (directory -> resource)
+	//
+	std::vector< std::vector< std::vector< bool > > > selected( archives.size() );
+
+	for ( std::size_t a = 0u; a < archives.size(); ++a )
+	{
+		const auto& directories = archives[ a ]->index().m_directories;
+
+		selected[ a ].resize( directories.size() );
+
+		for ( std::size_t d = 0u; d < directories.size(); ++d )
+			selected[ a ][ d ].resize( directories[ d ].m_resource.size(), false );
+	}
+
+	for ( const auto& [key, entry] : entries )
+		selected[ entry.m_archive ][ entry.m_directory ][ entry.m_resource ] = true;
+
+	for ( std::size_t a = 0u; a < archives.size(); ++a )
+	{
+		try
+		{
+			log( "Extracting: {}\n", archives[ a ]->path().stem().string() );
+
+			const auto& winners = selected[ a ];
+
+			const auto failed_resources = archives[ a ]->extract( save_path, [&winners] ( const std::size_t dir, const std::size_t res )
+			{
+				return winners[ dir ][ res ];
+			} );
+
+			if ( failed_resources )
+			{
+				log( " - Failed: {:d} resources\n", failed_resources );
+
+				++failed;
+			}
+		}
+		catch ( const std::exception& e )
+		{
+			log( "[FATAL] {:s}\n", e.what() );
+			pause();
+
+			++failed;
+		}
+	}
+
+	return failed;
+}
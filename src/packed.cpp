@@ -0,0 +1,283 @@
+#include "pch.hpp"
+#include "packed.hpp"
+
+#include "rez.hpp"
+#include "rez_file.hpp"
+
+namespace rez
+{
+
+static constexpr std::array< char, 4u > PACKED_MAGIC   = { 'R', 'Z', 'P', '1' };
+static constexpr std::uint32_t          PACKED_VERSION = 1u;
+
+static_assert( sizeof( packed_header_t ) == 64u );
+static_assert( sizeof( packed_slot_t ) == 16u );
+static_assert( sizeof( packed_entry_t ) == 32u );
+
+static auto align_up( const std::uint64_t value, const std::uint64_t alignment ) -> std::uint64_t
+{
+	return ( value + alignment - 1u ) & ~( alignment - 1u );
+}
+
+static auto normalize_char( const char ch ) -> char
+{
+	return ch == '\\' ? '/' : static_cast< char >( std::tolower( static_cast< unsigned char >( ch ) ) );
+}
+
+static auto equal_path( const std::string_view lhs, const std::string_view rhs ) -> bool
+{
+	return lhs.size() == rhs.size() && std::equal( lhs.begin(), lhs.end(), rhs.begin(), [] ( const char a, const char b )
+	{
+		return normalize_char( a ) == normalize_char( b );
+	} );
+}
+
+}
+
+auto rez::packed_hash( const std::string_view path ) -> std::uint64_t
+{
+	std::uint64_t hash = fnv1a( nullptr, 0u );
+
+	for ( const auto ch : path )
+	{
+		const auto value = normalize_char( ch );
+
+		hash = fnv1a( &value, 1u, hash );
+	}
+
+	return hash;
+}
+
+void rez::write_packed( c_rez_file& rez, const std::filesystem::path& output, const std::uint32_t alignment )
+{
+	if ( alignment == 0u || ( alignment & ( alignment - 1u ) ) != 0u )
+		REZ_THROW( " - Invalid alignment: {:d}", alignment );
+
+	// the payloads are read while the output is written
+	if ( std::error_code ec{}; std::filesystem::equivalent( output, rez.path(), ec ) )
+		REZ_THROW( " - Output is the input archive: {:s}", output.string() );
+
+	rez.read_index();
+
+	const auto& directories = rez.index().m_directories;
+
+	struct item_t
+	{
+		const block_resource_t* m_res;
+		std::string             m_path;
+	};
+
+	std::vector< item_t > items{};
+
+	for ( std::size_t d = 0u; d < directories.size(); ++d )
+	{
+		const auto dir_path = rez.directory_path( d );
+
+		for ( const auto& res : directories[ d ].m_resource )
+			items.emplace_back( item_t{ &res, ( dir_path / c_rez_file::resource_filename( res ) ).generic_string() } );
+	}
+
+	//
+	// keep the payloads in archive order, the copy reads sequentially
+	//
+	std::stable_sort( items.begin(), items.end(), [] ( const item_t& lhs, const item_t& rhs )
+	{
+		return lhs.m_res->m_header.m_pos < rhs.m_res->m_header.m_pos;
+	} );
+
+	packed_header_t header{ PACKED_MAGIC, PACKED_VERSION, alignment, static_cast< std::uint32_t >( items.size() ) };
+
+	// load factor <= 0.5
+	header.m_slot_count = 1u;
+
+	while ( header.m_slot_count < items.size() * 2u )
+		header.m_slot_count <<= 1u;
+
+	std::vector< packed_slot_t >  slots( header.m_slot_count );
+	std::vector< packed_entry_t > entries( items.size() );
+	std::string                   paths{};
+
+	header.m_slots_pos   = sizeof( packed_header_t );
+	header.m_entries_pos = header.m_slots_pos + slots.size() * sizeof( packed_slot_t );
+	header.m_paths_pos   = header.m_entries_pos + entries.size() * sizeof( packed_entry_t );
+
+	for ( std::size_t i = 0u; i < items.size(); ++i )
+	{
+		auto& entry = entries[ i ];
+
+		entry.m_size      = items[ i ].m_res->m_header.m_size;
+		entry.m_time      = items[ i ].m_res->m_header.m_time;
+		entry.m_path_pos  = paths.size();
+		entry.m_path_size = static_cast< std::uint32_t >( items[ i ].m_path.size() );
+
+		paths.append( items[ i ].m_path );
+
+		//
+		// linear probing, a duplicate path keeps the first entry
+		//
+		const auto hash = packed_hash( items[ i ].m_path );
+
+		for ( auto slot = hash & ( header.m_slot_count - 1u ); ; slot = ( slot + 1u ) & ( header.m_slot_count - 1u ) )
+		{
+			if ( slots[ slot ].m_entry == 0u )
+			{
+				slots[ slot ] = { hash, static_cast< std::uint32_t >( i + 1u ) };
+
+				break;
+			}
+
+			if ( slots[ slot ].m_hash == hash && equal_path( items[ slots[ slot ].m_entry - 1u ].m_path, items[ i ].m_path ) )
+			{
+				log( " - Duplicate path: {:s}\n", items[ i ].m_path );
+
+				break;
+			}
+		}
+	}
+
+	header.m_paths_size = paths.size();
+
+	//
+	// payloads
+	//
+	std::uint64_t pos = align_up( header.m_paths_pos + header.m_paths_size, alignment );
+
+	for ( auto& entry : entries )
+	{
+		entry.m_pos = pos;
+
+		pos = align_up( pos + entry.m_size, alignment );
+	}
+
+	header.m_file_size = pos;
+
+	try
+	{
+		std::ofstream out{};
+		out.exceptions( std::ios::badbit | std::ios::failbit );
+		out.open( output, std::ios::binary );
+
+		out.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+		out.write( reinterpret_cast< const char* >( slots.data() ), static_cast< std::streamsize >( slots.size() * sizeof( packed_slot_t ) ) );
+		out.write( reinterpret_cast< const char* >( entries.data() ), static_cast< std::streamsize >( entries.size() * sizeof( packed_entry_t ) ) );
+		out.write( paths.data(), static_cast< std::streamsize >( paths.size() ) );
+
+		static constexpr std::uint32_t STEP_DATA_SIZE = 1'048'576u;
+
+		auto data = std::make_unique< char[] >( STEP_DATA_SIZE );
+
+		std::uint64_t written = header.m_paths_pos + header.m_paths_size;
+
+		auto pad = [&] ( const std::uint64_t to ) -> void
+		{
+			static constexpr std::array< char, 0x1000 > zero{};
+
+			while ( written < to )
+			{
+				const auto step = std::min< std::uint64_t >( to - written, zero.size() );
+
+				out.write( zero.data(), static_cast< std::streamsize >( step ) );
+
+				written += step;
+			}
+		};
+
+		for ( std::size_t i = 0u; i < items.size(); ++i )
+		{
+			const auto& res = *items[ i ].m_res;
+
+			pad( entries[ i ].m_pos );
+
+			for ( std::uint32_t step = 0u; step < res.m_header.m_size; )
+			{
+				const std::uint32_t step_size = std::min( res.m_header.m_size - step, STEP_DATA_SIZE );
+
+				rez.read_at( res.m_header.m_pos + step, data.get(), step_size );
+
+				if ( g_dtx_to_lithtech && step == 0u )
+					c_rez_file::convert_dtx( res, data.get(), step_size );
+
+				out.write( data.get(), step_size );
+
+				step    += step_size;
+				written += step_size;
+			}
+		}
+
+		pad( header.m_file_size );
+
+		out.close();
+	}
+	catch ( ... )
+	{
+		// no truncated file left behind
+		std::error_code ec{};
+
+		std::filesystem::remove( output, ec );
+
+		throw;
+	}
+
+	log( "Packed: {:d} resources, {:d} slots, {:d} bytes\n", entries.size(), slots.size(), header.m_file_size );
+}
+
+rez::c_packed_file::c_packed_file( const std::filesystem::path& path ) :
+	m_file{ path },
+	m_header{ nullptr },
+	m_slots{ nullptr },
+	m_entries{ nullptr },
+	m_paths{ nullptr }
+{
+	m_header = reinterpret_cast< const packed_header_t* >( m_file.view( 0u, sizeof( packed_header_t ) ).data() );
+
+	if ( m_header->m_magic != PACKED_MAGIC )
+		REZ_THROW( " - Invalid packed magic" );
+
+	if ( m_header->m_version != PACKED_VERSION )
+		REZ_THROW( " - Invalid packed version (Expected: {:d} | Current: {:d})", PACKED_VERSION, m_header->m_version );
+
+	if ( m_header->m_file_size != m_file.size() )
+		REZ_THROW( " - Invalid packed size (Expected: {:d} | Current: {:d})", m_header->m_file_size, m_file.size() );
+
+	if ( m_header->m_slot_count == 0u || ( m_header->m_slot_count & ( m_header->m_slot_count - 1u ) ) != 0u )
+		REZ_THROW( " - Invalid packed slot count: {:d}", m_header->m_slot_count );
+
+	//
+	// the views are bounds checked once, lookups trust the tables
+	//
+	m_slots   = reinterpret_cast< const packed_slot_t* >( m_file.view( m_header->m_slots_pos, std::uint64_t{ m_header->m_slot_count } * sizeof( packed_slot_t ) ).data() );
+	m_entries = reinterpret_cast< const packed_entry_t* >( m_file.view( m_header->m_entries_pos, std::uint64_t{ m_header->m_entry_count } * sizeof( packed_entry_t ) ).data() );
+	m_paths   = m_file.view( m_header->m_paths_pos, m_header->m_paths_size ).data();
+}
+
+auto rez::c_packed_file::find( const std::string_view path ) const -> const packed_entry_t*
+{
+	const auto hash = packed_hash( path );
+	const auto mask = m_header->m_slot_count - 1u;
+
+	for ( std::uint64_t probe = 0u, slot = hash & mask; probe <= mask; ++probe, slot = ( slot + 1u ) & mask )
+	{
+		const auto& value = m_slots[ slot ];
+
+		if ( value.m_entry == 0u || value.m_entry > m_header->m_entry_count )
+			return nullptr;
+
+		if ( value.m_hash == hash && equal_path( this->path( m_entries[ value.m_entry - 1u ] ), path ) )
+			return &m_entries[ value.m_entry - 1u ];
+	}
+
+	return nullptr;
+}
+
+auto rez::c_packed_file::path( const packed_entry_t& entry ) const -> std::string_view
+{
+	if ( entry.m_path_pos > m_header->m_paths_size || entry.m_path_size > m_header->m_paths_size - entry.m_path_pos )
+		REZ_THROW( " - Invalid packed path" );
+
+	return { m_paths + entry.m_path_pos, entry.m_path_size };
+}
+
+auto rez::c_packed_file::data( const packed_entry_t& entry ) const -> std::string_view
+{
+	return m_file.view( entry.m_pos, entry.m_size );
+}
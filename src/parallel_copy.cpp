@@ -0,0 +1,122 @@
+#include "pch.hpp"
+#include "parallel_copy.hpp"
+
+#include "buffer_pool.hpp"
+#include "io_tuning.hpp"
+#include "rez.hpp"
+#include "rez_file.hpp"
+#include "throttle.hpp"
+#include "writer.hpp"
+
+auto rez::copy_parallel( const std::filesystem::path& archive, const block_resource_t& res, const std::filesystem::path& output ) -> parallel_copy_t
+{
+	const std::uint64_t size = res.m_header.m_size;
+
+	// a chunk fits a single pool buffer, and covers whole 64K blocks when sparse (only a whole zero chunk is skipped)
+	std::uint64_t chunk_size = std::max< std::uint64_t >( std::min( g_io_tuning.m_chunk_size, c_buffer_pool::SIZE_CLASSES.back() ), 1u );
+
+	if ( g_sparse )
+		chunk_size = ( chunk_size + c_writer::SPARSE_BLOCK - 1u ) / c_writer::SPARSE_BLOCK * c_writer::SPARSE_BLOCK;
+
+	const std::uint64_t chunks = ( size + chunk_size - 1u ) / chunk_size;
+
+	const auto threads = static_cast< std::size_t >( std::clamp< std::uint64_t >( g_io_tuning.m_concurrency, 1u, std::max< std::uint64_t >( chunks, 1u ) ) );
+
+	g_throttle.create();
+
+	const c_positional_file in{ archive, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING };
+	const c_positional_file out{ output, GENERIC_WRITE, 0u, CREATE_ALWAYS };
+
+	//
+	// a sparse file only allocates what is written, reserving the clusters would defeat it
+	//
+	bool sparse = false;
+
+	if ( g_sparse )
+	{
+		DWORD bytes = 0u;
+
+		sparse = ::DeviceIoControl( out.handle(), FSCTL_SET_SPARSE, nullptr, 0u, nullptr, 0u, &bytes, nullptr ) != FALSE;
+	}
+
+	if ( !sparse )
+		out.preallocate( size );
+
+	// chunks start on a 64K boundary, a whole zero chunk is whole allocation units
+	const bool skip_zero = sparse && chunk_size % c_writer::SPARSE_BLOCK == 0u;
+
+	std::atomic< std::uint64_t > next{ 0u };
+	std::atomic< std::uint64_t > skipped{ 0u };
+	std::atomic< bool >          failed{ false };
+
+	std::exception_ptr error{};
+	std::mutex         error_mutex{};
+
+	auto work = [&] () -> void
+	{
+		const auto event = ::CreateEventW( nullptr, TRUE, FALSE, nullptr );
+
+		try
+		{
+			if ( !event )
+				REZ_THROW( " - CreateEvent: {:s}", std::system_category().message( ::GetLastError() ) );
+
+			const auto buffer = shared_buffer_pool().acquire( static_cast< std::size_t >( chunk_size ) );
+			const auto data   = buffer.data();
+
+			for ( auto chunk = next++; chunk < chunks && !failed; chunk = next++ )
+			{
+				const auto pos  = chunk * chunk_size;
+				const auto step = static_cast< std::uint32_t >( std::min( chunk_size, size - pos ) );
+
+				g_throttle.read( step );
+
+				in.read_at( res.m_header.m_pos + pos, data, step, event );
+
+				if ( g_dtx_to_lithtech && chunk == 0u )
+					c_rez_file::convert_dtx( res, data, step );
+
+				if ( skip_zero && step == chunk_size && c_writer::is_zero( data, step ) )
+				{
+					skipped += step;
+
+					continue;
+				}
+
+				g_throttle.write( step );
+
+				out.write_at( pos, data, step, event );
+			}
+		}
+		catch ( ... )
+		{
+			std::scoped_lock lock{ error_mutex };
+
+			if ( !error )
+				error = std::current_exception();
+
+			failed = true;
+		}
+
+		if ( event )
+			::CloseHandle( event );
+	};
+
+	std::vector< std::thread > workers{};
+
+	for ( std::size_t i = 1u; i < threads; ++i )
+		workers.emplace_back( work );
+
+	work();
+
+	for ( auto& worker : workers )
+		worker.join();
+
+	if ( error )
+		std::rethrow_exception( error );
+
+	// a skipped chunk at the end is never written
+	out.set_size( size );
+
+	return { size, skipped };
+}
@@ -0,0 +1,566 @@
+#include "pch.hpp"
+#include "patch.hpp"
+
+#include "rez_file.hpp"
+
+namespace rez
+{
+
+static constexpr std::array< char, 4u > PATCH_MAGIC   = { 'R', 'Z', 'P', '1' };
+static constexpr std::uint32_t          PATCH_VERSION = 1u;
+
+static_assert( sizeof( patch_header_t ) == 48u );
+static_assert( sizeof( patch_op_t ) == 24u );
+
+//
+// delta granularity, small enough to keep the untouched parts of a patched texture/model
+//
+static constexpr std::uint32_t PATCH_BLOCK = 0x10000u;
+
+static constexpr std::uint32_t STEP_DATA_SIZE = 1'048'576u;
+
+// fnv1a seed, hashes chained over several reads start from it
+static constexpr std::uint64_t FNV_OFFSET = 0xCBF29CE484222325ull;
+
+//
+// a literal is flushed as its own op once this large, the pending bytes stay bounded
+//
+static constexpr std::size_t LITERAL_FLUSH = 0x400000u;
+
+static auto resource_key( const c_rez_file& rez, const std::size_t dir, const block_resource_t& res ) -> std::string
+{
+	return to_lower( ( rez.directory_path( dir ) / c_rez_file::resource_filename( res ) ).generic_string() );
+}
+
+static auto content_key( const std::uint64_t size, const std::uint64_t hash ) -> std::uint64_t
+{
+	return fnv1a( &size, sizeof( size ), hash );
+}
+
+static auto header_hash( c_rez_file& rez ) -> std::uint64_t
+{
+	std::vector< char > header( header_layout( rez.header() ).size(), '\0' );
+
+	rez.read_at( 0u, header.data(), static_cast< std::uint32_t >( header.size() ) );
+
+	return fnv1a( header.data(), header.size() );
+}
+
+/**
+ * @brief fnv1a of an archive range, read in steps
+ */
+static auto range_hash( c_rez_file& rez, const std::uint32_t pos, const std::uint32_t size, char* data ) -> std::uint64_t
+{
+	std::uint64_t seed = FNV_OFFSET;
+
+	for ( std::uint32_t step = 0u; step < size; )
+	{
+		const std::uint32_t step_size = std::min( size - step, STEP_DATA_SIZE );
+
+		rez.read_at( pos + step, data, step_size );
+
+		seed = fnv1a( data, step_size, seed );
+		step += step_size;
+	}
+
+	return seed;
+}
+
+/**
+ * @brief compare a range of each archive, read in steps
+ */
+static auto range_equal(
+	c_rez_file& old_rez,
+	const std::uint32_t old_pos,
+	c_rez_file& new_rez,
+	const std::uint32_t new_pos,
+	const std::uint32_t size,
+	char* old_data,
+	char* new_data
+) -> bool
+{
+	for ( std::uint32_t step = 0u; step < size; )
+	{
+		const std::uint32_t step_size = std::min( size - step, STEP_DATA_SIZE );
+
+		old_rez.read_at( old_pos + step, old_data, step_size );
+		new_rez.read_at( new_pos + step, new_data, step_size );
+
+		if ( std::memcmp( old_data, new_data, step_size ) != 0 )
+			return false;
+
+		step += step_size;
+	}
+
+	return true;
+}
+
+/**
+ * @brief appends ops, neighbouring copies and literals are merged into a single op
+ */
+class c_op_writer
+{
+public:
+	c_op_writer( std::ofstream& out ) :
+		m_out{ out }
+	{
+	}
+public:
+	void copy( const std::uint64_t pos, const std::uint64_t size )
+	{
+		if ( size == 0u )
+			return;
+
+		this->flush_literal();
+
+		m_stats.m_copy_bytes += size;
+
+		if ( m_copy && m_copy->m_pos + m_copy->m_size == pos )
+		{
+			m_copy->m_size += size;
+
+			return;
+		}
+
+		this->flush_copy();
+
+		m_copy = patch_op_t{ patch_op_type_copy, 0u, pos, size };
+	}
+
+	void literal( const char* data, const std::size_t size )
+	{
+		if ( size == 0u )
+			return;
+
+		this->flush_copy();
+
+		m_stats.m_literal_bytes += size;
+
+		m_literal.insert( m_literal.end(), data, data + size );
+
+		if ( m_literal.size() >= LITERAL_FLUSH )
+			this->flush_literal();
+	}
+
+	auto finish() -> patch_stats_t
+	{
+		this->flush_copy();
+		this->flush_literal();
+
+		return m_stats;
+	}
+private:
+	void flush_copy()
+	{
+		if ( !m_copy )
+			return;
+
+		m_out.write( reinterpret_cast< const char* >( &*m_copy ), sizeof( patch_op_t ) );
+
+		++m_stats.m_op_count;
+
+		m_copy.reset();
+	}
+
+	void flush_literal()
+	{
+		if ( m_literal.empty() )
+			return;
+
+		const patch_op_t op{ patch_op_type_literal, 0u, 0u, m_literal.size() };
+
+		m_out.write( reinterpret_cast< const char* >( &op ), sizeof( op ) );
+		m_out.write( m_literal.data(), static_cast< std::streamsize >( m_literal.size() ) );
+
+		++m_stats.m_op_count;
+
+		m_literal.clear();
+	}
+private:
+	std::ofstream&              m_out;
+
+	std::optional< patch_op_t > m_copy{};
+	std::vector< char >         m_literal{};
+
+	patch_stats_t               m_stats{};
+};
+
+}
+
+auto rez::write_patch( c_rez_file& old_rez, c_rez_file& new_rez, const std::filesystem::path& output, const patch_options_t& options ) -> patch_stats_t
+{
+	// both archives are read while the patch is written, and a failed patch is removed
+	for ( const auto archive : { &old_rez, &new_rez } )
+	{
+		if ( std::error_code ec{}; std::filesystem::equivalent( output, archive->path(), ec ) )
+			REZ_THROW( " - Output is an archive of the patch: {:s}", output.string() );
+	}
+
+	old_rez.read_index();
+	new_rez.read_index();
+
+	const auto& old_dirs = old_rez.index().m_directories;
+	const auto& new_dirs = new_rez.index().m_directories;
+
+	patch_stats_t stats{};
+
+	//
+	// index comparison, also finds the old resource a changed one is delta encoded against
+	//
+	std::unordered_map< std::string, const block_resource_t* > old_paths{};
+
+	for ( std::size_t d = 0u; d < old_dirs.size(); ++d )
+	{
+		for ( const auto& res : old_dirs[ d ].m_resource )
+			old_paths.emplace( resource_key( old_rez, d, res ), &res );
+	}
+
+	std::unordered_map< const block_resource_t*, const block_resource_t* > previous{};
+	std::unordered_set< std::uint64_t >                                    new_sizes{};
+
+	std::size_t matched = 0u;
+
+	for ( std::size_t d = 0u; d < new_dirs.size(); ++d )
+	{
+		for ( const auto& res : new_dirs[ d ].m_resource )
+		{
+			new_sizes.emplace( res.m_header.m_size );
+
+			const auto it = old_paths.find( resource_key( new_rez, d, res ) );
+
+			if ( it == old_paths.end() )
+			{
+				++stats.m_added;
+
+				continue;
+			}
+
+			++matched;
+
+			const auto& old_header = it->second->m_header;
+
+			if ( old_header.m_size == res.m_header.m_size && old_header.m_time == res.m_header.m_time )
+				++stats.m_unchanged;
+			else
+				++stats.m_modified;
+
+			previous.emplace( &res, it->second );
+		}
+	}
+
+	stats.m_removed = old_paths.size() - std::min( matched, old_paths.size() );
+
+	const auto old_size = std::filesystem::file_size( old_rez.path() );
+	const auto new_size = std::filesystem::file_size( new_rez.path() );
+
+	auto data     = std::make_unique< char[] >( STEP_DATA_SIZE );
+	auto old_data = std::make_unique< char[] >( STEP_DATA_SIZE );
+
+	//
+	// content hashes of the old payloads, only sizes the new archive has can match
+	//
+	std::unordered_map< std::uint64_t, std::uint32_t > old_content{};
+
+	for ( const auto& dir : old_dirs )
+	{
+		for ( const auto& res : dir.m_resource )
+		{
+			const auto& header = res.m_header;
+
+			if ( header.m_size == 0u || !new_sizes.contains( header.m_size ) || header.m_pos + static_cast< std::uint64_t >( header.m_size ) > old_size )
+				continue;
+
+			old_content.emplace( content_key( header.m_size, range_hash( old_rez, header.m_pos, header.m_size, data.get() ) ), header.m_pos );
+		}
+	}
+
+	//
+	// new payloads in file order, a range shared by several resources is written once
+	//
+	std::vector< const block_resource_t* > payloads{};
+
+	for ( const auto& dir : new_dirs )
+	{
+		for ( const auto& res : dir.m_resource )
+		{
+			if ( res.m_header.m_size != 0u && res.m_header.m_pos + static_cast< std::uint64_t >( res.m_header.m_size ) <= new_size )
+				payloads.emplace_back( &res );
+		}
+	}
+
+	std::sort( payloads.begin(), payloads.end(), [] ( const block_resource_t* a, const block_resource_t* b )
+	{
+		return a->m_header.m_pos < b->m_header.m_pos;
+	} );
+
+	try
+	{
+		std::ofstream out{};
+		out.exceptions( std::ios::badbit | std::ios::failbit );
+		out.open( output, std::ios::binary );
+
+		patch_header_t header{ PATCH_MAGIC, PATCH_VERSION, old_size, header_hash( old_rez ), new_size };
+
+		// written again once the ops are known
+		out.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+
+		c_op_writer ops{ out };
+
+		std::uint64_t new_hash = FNV_OFFSET;
+		std::uint64_t cursor   = 0u;
+
+		// header, directory blocks and whatever else lies between the payloads
+		auto literal_to = [&] ( const std::uint64_t end )
+		{
+			while ( cursor < end )
+			{
+				const auto step_size = static_cast< std::uint32_t >( std::min< std::uint64_t >( end - cursor, STEP_DATA_SIZE ) );
+
+				new_rez.read_at( static_cast< std::uint32_t >( cursor ), data.get(), step_size );
+
+				new_hash = fnv1a( data.get(), step_size, new_hash );
+
+				ops.literal( data.get(), step_size );
+
+				cursor += step_size;
+			}
+		};
+
+		std::vector< char > old_block( PATCH_BLOCK, '\0' );
+
+		for ( const auto res : payloads )
+		{
+			const std::uint32_t pos  = res->m_header.m_pos;
+			const std::uint32_t size = res->m_header.m_size;
+
+			// overlaps a payload already written
+			if ( pos < cursor )
+				continue;
+
+			literal_to( pos );
+
+			std::uint64_t hash = FNV_OFFSET;
+
+			for ( std::uint32_t step = 0u; step < size; )
+			{
+				const std::uint32_t step_size = std::min( size - step, STEP_DATA_SIZE );
+
+				new_rez.read_at( pos + step, data.get(), step_size );
+
+				hash     = fnv1a( data.get(), step_size, hash );
+				new_hash = fnv1a( data.get(), step_size, new_hash );
+
+				step += step_size;
+			}
+
+			cursor += size;
+
+			// the hash only picks the candidate, a collision falls through to the delta
+			if ( const auto it = old_content.find( content_key( size, hash ) ); it != old_content.end() && range_equal( old_rez, it->second, new_rez, pos, size, old_data.get(), data.get() ) )
+			{
+				ops.copy( it->second, size );
+
+				++stats.m_copied;
+
+				continue;
+			}
+
+			const auto it = previous.find( res );
+
+			const auto old_res = it != previous.end() ? it->second : nullptr;
+
+			if ( size < options.m_delta_threshold || !old_res || old_res->m_header.m_pos + static_cast< std::uint64_t >( old_res->m_header.m_size ) > old_size )
+			{
+				for ( std::uint32_t step = 0u; step < size; )
+				{
+					const std::uint32_t step_size = std::min( size - step, STEP_DATA_SIZE );
+
+					new_rez.read_at( pos + step, data.get(), step_size );
+
+					ops.literal( data.get(), step_size );
+
+					step += step_size;
+				}
+
+				continue;
+			}
+
+			//
+			// block delta, a new block may come from any block of the old resource (moved within the file)
+			//
+			const std::uint32_t old_pos    = old_res->m_header.m_pos;
+			const std::uint32_t old_length = old_res->m_header.m_size;
+
+			std::unordered_map< std::uint64_t, std::uint32_t > old_blocks{};
+
+			for ( std::uint32_t step = 0u; step + PATCH_BLOCK <= old_length; step += PATCH_BLOCK )
+			{
+				old_rez.read_at( old_pos + step, old_block.data(), PATCH_BLOCK );
+
+				old_blocks.emplace( fnv1a( old_block.data(), PATCH_BLOCK ), old_pos + step );
+			}
+
+			for ( std::uint32_t step = 0u; step < size; )
+			{
+				const std::uint32_t step_size = std::min( size - step, PATCH_BLOCK );
+
+				new_rez.read_at( pos + step, data.get(), step_size );
+
+				const auto match = step_size == PATCH_BLOCK ? old_blocks.find( fnv1a( data.get(), step_size ) ) : old_blocks.end();
+
+				bool copied = false;
+
+				// the hash only picks the candidate
+				if ( match != old_blocks.end() )
+				{
+					old_rez.read_at( match->second, old_block.data(), PATCH_BLOCK );
+
+					copied = std::memcmp( old_block.data(), data.get(), PATCH_BLOCK ) == 0;
+				}
+
+				if ( copied )
+					ops.copy( match->second, step_size );
+				else
+					ops.literal( data.get(), step_size );
+
+				step += step_size;
+			}
+
+			++stats.m_delta;
+		}
+
+		literal_to( new_size );
+
+		const auto written = ops.finish();
+
+		stats.m_copy_bytes    = written.m_copy_bytes;
+		stats.m_literal_bytes = written.m_literal_bytes;
+		stats.m_op_count      = written.m_op_count;
+		stats.m_new_size      = new_size;
+
+		header.m_new_hash = new_hash;
+		header.m_op_count = written.m_op_count;
+
+		stats.m_patch_size = static_cast< std::uint64_t >( out.tellp() );
+
+		out.seekp( 0 );
+		out.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+
+		out.close();
+	}
+	catch ( ... )
+	{
+		// no truncated patch left behind
+		std::error_code ec{};
+
+		std::filesystem::remove( output, ec );
+
+		throw;
+	}
+
+	return stats;
+}
+
+auto rez::apply_patch( const std::filesystem::path& old_path, const std::filesystem::path& patch, const std::filesystem::path& output ) -> patch_stats_t
+{
+	// the old archive is read while the output is written
+	if ( std::error_code ec{}; std::filesystem::equivalent( output, old_path, ec ) )
+		REZ_THROW( " - Output is the old archive: {:s}", output.string() );
+
+	auto old_rez = c_rez_file{ old_path };
+
+	old_rez.load();
+
+	c_reader reader{ patch };
+
+	const auto header = reader.read< patch_header_t >();
+
+	if ( header.m_magic != PATCH_MAGIC )
+		REZ_THROW( " - Invalid patch magic" );
+
+	if ( header.m_version != PATCH_VERSION )
+		REZ_THROW( " - Invalid patch version (Expected: {:d} | Current: {:d})", PATCH_VERSION, header.m_version );
+
+	const auto old_size = std::filesystem::file_size( old_path );
+
+	if ( header.m_old_size != old_size || header.m_old_hash != header_hash( old_rez ) )
+		REZ_THROW( " - Patch doesn't apply to {:s} (Expected size: {:d} | Current: {:d})", old_path.string(), header.m_old_size, old_size );
+
+	patch_stats_t stats{};
+
+	auto data = std::make_unique< char[] >( STEP_DATA_SIZE );
+
+	std::uint64_t hash = FNV_OFFSET;
+	std::uint64_t size = 0u;
+
+	try
+	{
+		std::ofstream out{};
+		out.exceptions( std::ios::badbit | std::ios::failbit );
+		out.open( output, std::ios::binary );
+
+		for ( std::uint64_t i = 0u; i < header.m_op_count; ++i )
+		{
+			const auto op = reader.read< patch_op_t >();
+
+			if ( size + op.m_size > header.m_new_size )
+				REZ_THROW( " - Patch op {:d} exceeds the new size (Size: {:d} | Op: {:d})", i, header.m_new_size, op.m_size );
+
+			if ( op.m_type == patch_op_type_copy )
+			{
+				if ( op.m_pos + op.m_size > old_size )
+					REZ_THROW( " - Patch op {:d} reads past the old archive (Pos: {:d} | Size: {:d})", i, op.m_pos, op.m_size );
+
+				stats.m_copy_bytes += op.m_size;
+			}
+			else if ( op.m_type == patch_op_type_literal )
+			{
+				stats.m_literal_bytes += op.m_size;
+			}
+			else
+			{
+				REZ_THROW( " - Invalid patch op {:d} (Type: {:d})", i, op.m_type );
+			}
+
+			for ( std::uint64_t step = 0u; step < op.m_size; )
+			{
+				const auto step_size = static_cast< std::uint32_t >( std::min< std::uint64_t >( op.m_size - step, STEP_DATA_SIZE ) );
+
+				if ( op.m_type == patch_op_type_copy )
+					old_rez.read_at( static_cast< std::uint32_t >( op.m_pos + step ), data.get(), step_size );
+				else
+					reader.read( data[ 0u ], step_size );
+
+				hash = fnv1a( data.get(), step_size, hash );
+
+				out.write( data.get(), step_size );
+
+				step += step_size;
+			}
+
+			size += op.m_size;
+		}
+
+		out.close();
+
+		//
+		// verified as written, a wrong old archive or a damaged patch never leaves an output behind
+		//
+		if ( size != header.m_new_size || hash != header.m_new_hash )
+			REZ_THROW( " - Patched archive doesn't match (Size: {:d} | Expected: {:d} | Hash: {:016X} | Expected: {:016X})", size, header.m_new_size, hash, header.m_new_hash );
+	}
+	catch ( ... )
+	{
+		std::error_code ec{};
+
+		std::filesystem::remove( output, ec );
+
+		throw;
+	}
+
+	stats.m_op_count   = header.m_op_count;
+	stats.m_new_size   = size;
+	stats.m_patch_size = std::filesystem::file_size( patch );
+
+	return stats;
+}
@@ -1,266 +1,254 @@
 #include "pch.hpp"
 #include "rez.hpp"
 
-#include "block.hpp"
-#include "reader.hpp"
+#include "rez_file.hpp"
+
+#include "buffer_pool.hpp"
+#include "durability.hpp"
+#include "io_tuning.hpp"
+#include "journal.hpp"
+#include "mapped_file.hpp"
+#include "parallel_copy.hpp"
+#include "salvage.hpp"
+#include "shard.hpp"
+#include "thread_pool.hpp"
+#include "throttle.hpp"
+#include "writer.hpp"
 
-namespace rez
-{
-
-/**
- * @brief rez header
- */
-struct rez_header_t
-{
-	char          m_cr1;
-	char          m_lf1;
-	std::string   m_file_type;
-	char          m_cr2;
-	char          m_lf2;
-	std::string   m_user_title;
-	char          m_cr3;
-	char          m_lf3;
-	char          m_eof1;
-	char          m_head;
-	std::string   m_encode;
-	char          m_tail;
-	char          m_detect_head;
-	std::string   m_detect_encode;
-	char          m_detect_tail;
-	std::uint32_t m_file_format_version;
-	std::uint32_t m_root_dir_pos;
-	std::uint32_t m_root_dir_size;
-	std::uint32_t m_root_dir_time;
-	std::uint32_t m_next_write_pos;
-	std::uint32_t m_time;
-	std::uint32_t m_largest_key_ary;
-	std::uint32_t m_largest_dir_name_size;
-	std::uint32_t m_largest_rez_name_size;
-	std::uint32_t m_largest_comment_size;
-	char          m_is_sorted;
-};
-
-/**
- * @brief represents a rez file
- */
-class c_rez_file
+void rez::c_rez_file::load()
 {
-public:
-	c_rez_file( const std::filesystem::path& input ) :
-		m_reader{ input },
-		m_path{ input }
-	{
-	}
-public:
-	void load();
-	void extract( const std::filesystem::path& output );
-private:
-	c_reader              m_reader;
-	std::filesystem::path m_path;
+	//
+	// the largest variant fits in a single read, the layout tables do the rest
+	//
+	std::array< char, HEADER_MAX_SIZE > data{};
 
-	rez_header_t          m_header;
-	rez_t                 m_rez;
-};
+	const auto size = m_reader.read_some( data.data(), data.size() );
 
+	m_header = parse_header( { data.data(), size } );
 }
 
-void rez::c_rez_file::load()
+void rez::c_rez_file::read_index()
 {
-	const std::string stem = m_path.stem().string();
+	if ( !m_rez.m_directories.empty() )
+		return;
 
-	// remove the extra spaces at the end of the array
-	auto remove_spaces{ []( const auto& arr ) -> std::string
+	if ( g_parallel_index )
 	{
-		std::string str{ arr.begin(), arr.end() };
+		std::unique_ptr< c_mapped_file > file{};
 
-		auto pos{ std::find_if( str.rbegin(), str.rend(), [] ( char ch )
+		try
 		{
-			return ch != ' ';
-		} ) };
-
-		if ( pos != str.rend() )
+			file = std::make_unique< c_mapped_file >( m_path );
+		}
+		catch ( const std::exception& e )
 		{
-			str.erase(
-				std::remove(
-					str.begin() + std::distance( pos, str.rend() ),
-					str.end(),
-					' '
-				),
-				str.end()
-			);
+			// i.e no address space for the whole archive on x86
+			log( " - Parallel index unavailable, using the recursive read{:s}\n", e.what() );
 		}
 
-		return str;
-	} };
+		if ( file )
+		{
+			m_rez.read_parallel( *file, m_header.m_root_dir_pos, m_header.m_root_dir_size, shared_thread_pool() );
 
-	m_header.m_cr1 = m_reader.read< char >();
+			m_index_source = index_source_parallel;
 
-	if ( m_header.m_cr1 != '\r' && m_header.m_cr1 != '&' )
-		REZ_THROW( " - Invalid cr1" );
+			return;
+		}
+	}
 
-	m_header.m_lf1 = m_reader.read< char >();
+	//
+	// Recursive read
+	//
+	m_rez.read( m_reader, m_header.m_root_dir_pos, m_header.m_root_dir_size );
 
-	if ( m_header.m_lf1 != '\n' && m_header.m_lf1 != '#' )
-		REZ_THROW( " - Invalid lf1" );
+	m_index_source = index_source_recursive;
+}
 
-	std::array< char, 60u > file_type{};
+void rez::c_rez_file::salvage()
+{
+	const c_mapped_file file{ m_path };
+
+	salvage_stats_t stats{};
+
+	m_rez = salvage_index( file, shared_thread_pool(), stats );
+
+	m_index_source = index_source_salvage;
+
+	log(
+		" - Salvage: {:d} candidates, {:d} roots, {:d} blocks, {:d} directories, {:d} resources ({:d} orphans, {:d} dropped) in {:.2f}s ({:.0f} MB/s)\n",
+		stats.m_candidates,
+		stats.m_roots,
+		stats.m_blocks,
+		stats.m_directories,
+		stats.m_resources,
+		stats.m_orphans,
+		stats.m_dropped,
+		stats.m_seconds,
+		static_cast< double >( file.size() ) / 1048576.0 / std::max( stats.m_seconds, 1e-6 )
+	);
+}
 
-	m_reader.read( file_type[ 0 ], file_type.size() );
+auto rez::c_rez_file::find( const std::string_view path ) -> std::optional< block_resource_t >
+{
+	//
+	// split path components
+	//
+	std::vector< std::string_view > parts{};
 
-	m_header.m_file_type = remove_spaces( file_type );
+	for ( std::size_t begin = 0u; begin <= path.size(); )
+	{
+		const auto end = std::min( path.find_first_of( "/\\", begin ), path.size() );
 
-	m_header.m_cr2 = m_reader.read< char >();
+		if ( end > begin )
+			parts.emplace_back( path.substr( begin, end - begin ) );
 
-	if ( m_header.m_cr2 != '\r' && m_header.m_cr2 != '!' )
-		REZ_THROW( " - Invalid cr2" );
+		begin = end + 1u;
+	}
 
-	m_header.m_lf2 = m_reader.read< char >();
+	if ( parts.empty() )
+		return std::nullopt;
 
-	if ( m_header.m_lf2 != '\n' && m_header.m_lf2 != '\"' )
-		REZ_THROW( " - Invalid lf2" );
+	const bool sorted = m_header.m_is_sorted != 0;
 
-	std::array< char, 60u > user_title{};
+	directory_block_t block{};
 
-	m_reader.read( user_title[ 0 ], user_title.size() );
+	std::uint32_t pos  = m_header.m_root_dir_pos;
+	std::uint32_t size = m_header.m_root_dir_size;
 
-	m_header.m_user_title = remove_spaces( user_title );
+	//
+	// walk down the directories, one block per level
+	//
+	for ( std::size_t i = 0u; i + 1u < parts.size(); ++i )
+	{
+		if ( size == 0u )
+			return std::nullopt;
 
-	m_header.m_cr3 = m_reader.read< char >();
+		block.read( m_reader, pos, size );
 
-	if ( m_header.m_cr3 != '\r' && m_header.m_cr3 != '%' )
-		REZ_THROW( " - Invalid cr3" );
+		const auto entry = block.find( file_directory_entry_type_directory, parts[ i ], {}, sorted );
 
-	m_header.m_lf3 = m_reader.read< char >();
+		if ( !entry )
+			return std::nullopt;
 
-	if ( m_header.m_lf3 != '\n' && m_header.m_lf3 != '\'' )
-		REZ_THROW( " - Invalid lf3" );
+		const auto header = block.header( *entry );
 
-	m_header.m_eof1 = m_reader.read< char >();
+		pos  = header.m_pos;
+		size = header.m_size;
+	}
 
-	if ( m_header.m_eof1 != 0x1A && m_header.m_eof1 != '*' )
-		REZ_THROW( " - Invalid eof1" );
+	if ( size == 0u )
+		return std::nullopt;
 
-	// eof values
-	static constexpr auto EOF1 = 0x1A;
-	static constexpr auto EOF2 = 0x2A;
+	block.read( m_reader, pos, size );
 
-	// file format version
-	static constexpr auto FFV1 = 0x1;
-	static constexpr auto FFV2 = 0x2;
+	//
+	// resource name and extension
+	//
+	const auto filename = parts.back();
+	const auto dot      = filename.rfind( '.' );
 
-	// use eof1 to determine the version
-	switch ( m_header.m_eof1 )
-	{
-	case EOF1:
-	{
-		const auto offset = m_reader.tell();
+	const auto name = dot != std::string_view::npos ? filename.substr( 0u, dot ) : filename;
+	const auto ext  = dot != std::string_view::npos ? filename.substr( dot + 1u ) : std::string_view{};
 
-		m_header.m_file_format_version = m_reader.read();
+	const auto entry = block.find( file_directory_entry_type_resource, name, ext, sorted );
 
-		if ( m_header.m_file_format_version != FFV1 )
-		{
-			// fallback to rez format 2
-			m_reader.seek( offset + 0x7 /*unknown bytes*/ );
+	if ( !entry )
+		return std::nullopt;
+
+	return block.resource( *entry );
+}
 
-			m_header.m_file_format_version = m_reader.read();
+void rez::c_rez_file::read_at( const std::uint32_t pos, char* data, const std::uint32_t size )
+{
+	if ( size == 0u )
+		return;
 
-			if ( m_header.m_file_format_version != FFV2 )
-				REZ_THROW( " - Invalid file format version (Expected: {:d} | Current: {:d})", FFV2, m_header.m_file_format_version );
-		}
+	m_reader.seek( pos );
+	m_reader.read( *data, size );
+}
 
-		break;
-	}
-	case EOF2:
-	{
-		m_header.m_head = m_reader.read< char >();
+auto rez::c_rez_file::read_resource( const block_resource_t& res ) -> std::vector< char >
+{
+	std::vector< char > data( res.m_header.m_size, '\0' );
 
-		std::array< char, 32u + 1u > encode{};
+	this->read_at( res.m_header.m_pos, data.data(), res.m_header.m_size );
 
-		m_reader.read( encode[ 0 ], encode.size() - 1 );
+	return data;
+}
 
-		m_header.m_encode = encode.data();
+auto rez::c_rez_file::directory_path( const std::size_t index ) const -> std::filesystem::path
+{
+	const auto& directories = m_rez.m_directories;
 
-		m_header.m_tail = m_reader.read< char >();
+	//
+	// walk up to the root directory
+	//
+	std::vector< std::string_view > v{};
 
-		m_header.m_detect_head = m_reader.read< char >();
+	for ( auto i = index; i != std::numeric_limits<std::size_t>::max(); i = directories.at( i ).m_owner_index )
+		v.emplace_back( directories.at( i ).m_name );
 
-		// head = 1, detect_head = 16
-		// 1 ^ 17 = 16
-		if ( m_header.m_detect_head != ( m_header.m_head ^ 0x11 ) )
-		{
-			REZ_THROW(
-				" - Invalid head (Head: {:d} | Detect: {:d} | Xor: {:d})",
-				m_header.m_head,
-				m_header.m_detect_head,
-				( m_header.m_head ^ 0x11 )
-			);
-		}
+	std::filesystem::path path = {};
 
-		std::array< char, 32u + 1u > detect_encode{};
+	for ( auto it = v.rbegin(); it != v.rend(); ++it )
+		path.append( *it );
 
-		m_reader.read( detect_encode[ 0 ], detect_encode.size() - 1u );
+	return path;
+}
 
-		m_header.m_detect_encode = detect_encode.data();
+auto rez::c_rez_file::resource_filename( const block_resource_t& res ) -> std::string
+{
+	auto filename{ res.m_name };
 
-		std::to_chars(
-			detect_encode.data(),
-			detect_encode.data() + m_header.m_detect_encode.size(),
-			std::atol( m_header.m_encode.data() ) ^ 0x16B4423 /*magic number*/
-		);
+	if ( res.m_type.size() )
+		filename.append( "." ).append( res.m_type );
 
-		if ( m_header.m_detect_encode != detect_encode.data() )
-		{
-			REZ_THROW(
-				" - Invalid encode (Encode: {:s} | Detect: {:s} | Xor: {:s})",
-				m_header.m_encode,
-				m_header.m_detect_encode,
-				detect_encode.data()
-			);
-		}
+	return filename;
+}
 
-		m_header.m_detect_tail = m_reader.read< char >();
+void rez::c_rez_file::convert_dtx( const block_resource_t& res, char* data, const std::size_t size )
+{
+	/**
+	 * DTX file extension
+	 */
+	static constexpr auto DTX_EXT_A{ "dtx" };
+	static constexpr auto DTX_EXT_B{ "DTX" };
+
+	/**
+	 * DTX header version
+	 */
+	static constexpr auto DTX_VER_LT1  = -2;
+	static constexpr auto DTX_VER_LT15 = -3;
+	static constexpr auto DTX_VER_LT2  = -5;
+
+	if ( size < 0xC )
+		return;
 
-		// tail = 16, m_detect_tail = 1
-		// 16 ^ 17 = 1
-		if ( m_header.m_detect_tail != ( m_header.m_tail ^ 0x11 ) )
-		{
-			REZ_THROW(
-				" - Invalid tail (Tail: {:d} | Detect: {:d} | Xor: {:d})",
-				m_header.m_tail,
-				m_header.m_detect_tail, ( m_header.m_tail ^ 0x11 )
-			);
-		}
+	if ( ( res.m_type == DTX_EXT_A ) || ( res.m_type == DTX_EXT_B ) )
+	{
+		/**
+		 * The DTX version in the header starts at offset 8, in some files it starts at offset 4
+		 * so we need to swap these bytes
+		 */
+		auto&  ver = data[ 0x4 ];
 
-		m_header.m_file_format_version = m_reader.read();
+		if ( ( ver != DTX_VER_LT1 ) && ( ver != DTX_VER_LT15 ) && ( ver != DTX_VER_LT2 ) )
+		{
+			std::array< char, 4u > lhs_bytes = {};
+			std::array< char, 4u > rhs_bytes = {};
 
-		if ( m_header.m_file_format_version != FFV1 )
-			REZ_THROW( " - Invalid file format version (Expected: {:d} | Current: {:d})", FFV1, m_header.m_file_format_version );
+			std::memcpy( lhs_bytes.data(), &data[ 0x4 ], lhs_bytes.size() );
+			std::memcpy( rhs_bytes.data(), &data[ 0x8 ], rhs_bytes.size() );
 
-		break;
-	}
-	default:
-	break;
+			std::memcpy( &data[ 0x4 ], rhs_bytes.data(), rhs_bytes.size() );
+			std::memcpy( &data[ 0x8 ], lhs_bytes.data(), lhs_bytes.size() );
+		}
 	}
-
-	m_header.m_root_dir_pos = m_reader.read();
-	m_header.m_root_dir_size = m_reader.read();
-	m_header.m_root_dir_time = m_reader.read();
-	m_header.m_next_write_pos = m_reader.read();
-	m_header.m_time = m_reader.read();
-	m_header.m_largest_key_ary = m_reader.read();
-	m_header.m_largest_dir_name_size = m_reader.read();
-	m_header.m_largest_rez_name_size = m_reader.read();
-	m_header.m_largest_comment_size = m_reader.read();
-
-	m_header.m_is_sorted = m_reader.read< char >();
 }
 
-void rez::c_rez_file::extract( const std::filesystem::path& output )
+auto rez::c_rez_file::extract( const std::filesystem::path& output, const filter_t& filter, const done_t& done ) -> std::size_t
 {
-	//
-	// Recursive read
-	//
-	m_rez.read( m_reader, m_header.m_root_dir_pos, m_header.m_root_dir_size );
+	this->read_index();
 
 	auto& directories = m_rez.m_directories;
 
@@ -268,29 +256,37 @@ void rez::c_rez_file::extract( const std::filesystem::path& output )
 	{
 		log( " - No directory found\n" );
 
-		return;
+		return 0u;
 	}
 
 	auto create_dirs = [] ( const std::filesystem::path& path ) -> void
 	{
 		std::error_code ec = {};
 
-		if ( !std::filesystem::create_directory( path, ec ) && ec )
+		if ( std::filesystem::create_directory( path, ec ) )
+			g_throttle.create();
+		else if ( ec )
 			REZ_THROW( " - {:s}: {:s}", path.string(), ec.message() );
 	};
 
 	//
-	// Extract 10MB per step
+	// buffers sized per resource, a small script doesn't hold a movie sized chunk
 	//
-	static constexpr std::uint32_t STEP_DATA_SIZE = 1'048'576u * 10u;
+	auto& pool = shared_buffer_pool();
+
+	std::uint64_t written = 0u;
+	std::uint64_t skipped = 0u;
+	std::size_t   failed  = 0u;
 
-	auto data = std::make_unique< char[] >( STEP_DATA_SIZE );
+	c_commit_queue commits{};
 
 	//
 	// Extract Rez
 	//
-	for ( const auto& dir : directories )
+	for ( std::size_t dir_index = 0u; dir_index < directories.size(); ++dir_index )
 	{
+		const auto& dir = directories[ dir_index ];
+
 		log( " - Directory: {:s}\n", dir.m_name );
 
 		std::filesystem::path path = {};
@@ -320,98 +316,174 @@ void rez::c_rez_file::extract( const std::filesystem::path& output )
 		{
 			path.append( *it );
 
-			// create the directory if necessary
-			create_dirs( output / path );
+			// create the directory if necessary, a shard finds the skeleton made by prepare_shard
+			if ( g_shard_count <= 1u )
+				create_dirs( output / path );
 		}
 
-		for ( const auto& res : dir.m_resource )
+		for ( std::size_t res_index = 0u; res_index < dir.m_resource.size(); ++res_index )
 		{
+			const auto& res = dir.m_resource[ res_index ];
+
+			if ( filter && !filter( dir_index, res_index ) )
+				continue;
+
 			log( "  - File: {:s}\n", res.m_name );
 
-			auto filename{ res.m_name };
-			if ( filename.empty() )
+			if ( res.m_name.empty() )
 				log( "  - Empty resource filename detected\n" );
 
-			if ( res.m_type.size() )
-				filename.append( "." ).append( res.m_type );
+			const auto filename = resource_filename( res );
+
+			//
+			// written aside and renamed into place (see c_commit_queue), a crash never leaves a truncated file under the real name
+			//
+			const auto file = output / path / filename;
+
+			auto part = file;
+
+			part += ".part";
+
+			// a file the queue fails to commit is counted there
+			const auto commit_failures = commits.stats().m_failed;
 
 			try
 			{
-				std::ofstream out{};
-				out.exceptions( std::ios::badbit | std::ios::failbit );
-				out.open( output / path / filename, std::ios::binary );
+				// a pending file of the same name (names ignore the case) must be in place before its ".part" is written again
+				commits.claim( file );
+
+				//
+				// a large resource would leave a single stream running long after the rest
+				//
+				if ( g_io_tuning.m_concurrency > 1u && res.m_header.m_size >= g_io_tuning.m_parallel_threshold )
+				{
+					const auto copied = copy_parallel( m_path, res, part );
 
-				if ( out )
+					written += copied.m_bytes;
+					skipped += copied.m_skipped;
+				}
+				else
 				{
+					g_throttle.create();
+
+					c_writer out{ part, g_sparse };
+
 					const std::uint32_t pos  = res.m_header.m_pos;
 					const std::uint32_t size = res.m_header.m_size;
 
+					const auto buffer = pool.acquire( std::min< std::size_t >( size, g_io_tuning.m_chunk_size ) );
+					const auto data   = buffer.data();
+
+					const auto step_data_size = static_cast< std::uint32_t >( std::min( buffer.size(), g_io_tuning.m_chunk_size ) );
+
 					std::uint32_t step = 0;
 
 					while ( step < size )
 					{
-						const std::uint32_t step_size = std::min( size - step, STEP_DATA_SIZE );
+						const std::uint32_t step_size = std::min( size - step, step_data_size );
+
+						g_throttle.read( step_size );
 
 						m_reader.seek( pos + static_cast< std::streamoff >( step ) );
 						m_reader.read( data[ 0u ], step_size );
 
 						if ( g_dtx_to_lithtech && step == 0u )
-						{
-							/**
-							 * DTX file extension
-							 */
-							static constexpr auto DTX_EXT_A{ "dtx" };
-							static constexpr auto DTX_EXT_B{ "DTX" };
-
-							/**
-							 * DTX header version
-							 */
-							static constexpr auto DTX_VER_LT1  = -2;
-							static constexpr auto DTX_VER_LT15 = -3;
-							static constexpr auto DTX_VER_LT2  = -5;
-
-							if ( ( res.m_type == DTX_EXT_A ) || ( res.m_type == DTX_EXT_B ) )
-							{
-								/**
-								 * The DTX version in the header starts at offset 8, in some files it starts at offset 4
-								 * so we need to swap these bytes
-								 */
-								auto&  ver = data[ 0x4 ];
-
-								if ( ( ver != DTX_VER_LT1 ) && ( ver != DTX_VER_LT15 ) && ( ver != DTX_VER_LT2 ) )
-								{
-									std::array< char, 4u > lhs_bytes = {};
-									std::array< char, 4u > rhs_bytes = {};
-
-									std::memcpy( lhs_bytes.data(), &data[ 0x4 ], lhs_bytes.size() );
-									std::memcpy( rhs_bytes.data(), &data[ 0x8 ], rhs_bytes.size() );
-
-									std::memcpy( &data[ 0x4 ], rhs_bytes.data(), rhs_bytes.size() );
-									std::memcpy( &data[ 0x8 ], lhs_bytes.data(), lhs_bytes.size() );
-								}
-							}
-						}
+							convert_dtx( res, data, step_size );
 
 						//
 						// write to file
 						//
-						out.write( data.get(), step_size );
+						g_throttle.write( step_size );
+
+						out.write( data, step_size );
 
 						step += step_size;
 					}
+
+					out.finish();
+
+					written += out.size();
+					skipped += out.skipped();
 				}
+
+				commits.add( part, file, res.m_header.m_size, [&done, dir_index, res_index] ()
+				{
+					if ( done )
+						done( dir_index, res_index );
+				} );
 			}
 			catch ( const std::exception& e )
 			{
+				std::error_code ec{};
+
+				std::filesystem::remove( part, ec );
+
+				if ( commits.stats().m_failed == commit_failures )
+					++failed;
+
 				log( "{:s}\n", e.what() );
 				pause();
 			}
 		}
 	}
+
+	commits.finish();
+
+	if ( g_sparse )
+		log( " - Sparse: {:d} of {:d} bytes left as holes\n", skipped, written );
+
+	if ( g_durability.m_mode != durability_none )
+	{
+		const auto& stats = commits.stats();
+
+		log(
+			" - Durability: {:s}, {:d} files ({:d} failed) in {:d} flushes, {:.2f}s flushing\n",
+			durability_name( g_durability.m_mode ),
+			stats.m_files,
+			stats.m_failed,
+			stats.m_batches,
+			stats.m_flush_seconds
+		);
+	}
+
+	return failed + commits.stats().m_failed;
 }
 
-void rez::extract( const std::vector<std::filesystem::path>& file_path, const std::filesystem::path& save_path )
+auto rez::c_rez_file::fingerprint() const -> std::uint64_t
 {
+	const std::array< std::uint64_t, 6u > values =
+	{
+		std::filesystem::file_size( m_path ),
+		m_header.m_root_dir_pos,
+		m_header.m_root_dir_size,
+		m_header.m_root_dir_time,
+		m_header.m_next_write_pos,
+		m_header.m_time
+	};
+
+	return fnv1a( values.data(), sizeof( values ) );
+}
+
+void rez::c_rez_file::create_directories( const std::filesystem::path& output ) const
+{
+	for ( std::size_t i = 0u; i < m_rez.m_directories.size(); ++i )
+		std::filesystem::create_directories( output / this->directory_path( i ) );
+}
+
+auto rez::extract( const std::vector<std::filesystem::path>& file_path, const std::filesystem::path& save_path ) -> std::size_t
+{
+	tune_io( save_path );
+
+	//
+	// the finished resources of an interrupted run are skipped
+	//
+	std::optional< c_journal > journal{};
+
+	if ( g_resume )
+		journal.emplace( save_path );
+
+	std::size_t failed = 0u;
+
 	for ( const auto& file : file_path )
 	{
 		try
@@ -421,16 +493,98 @@ void rez::extract( const std::vector<std::filesystem::path>& file_path, const st
 			// open stream to read
 			auto rez = c_rez_file{ file };
 
-			// load info
-			rez.load();
+			try
+			{
+				// load info
+				rez.load();
+				rez.read_index();
+			}
+			catch ( const std::exception& e )
+			{
+				if ( !g_salvage )
+					throw;
+
+				log( "{:s}\n - Salvaging\n", e.what() );
+
+				rez.salvage();
+			}
+
+			std::optional< shard_plan_t > plan{};
+
+			if ( g_shard_count > 1u )
+			{
+				plan = plan_shards( rez.index(), g_shard_count );
+
+				const auto range = plan->m_ranges[ g_shard_index ];
+
+				log(
+					" - Shard {:d}/{:d}: {:d} resources, {:d} bytes (Pos: {:d} - {:d})\n",
+					g_shard_index,
+					g_shard_count,
+					range.m_resources,
+					range.m_bytes,
+					range.m_begin,
+					range.m_end
+				);
+
+				prepare_shard( rez, save_path, g_shard_index, std::chrono::seconds{ g_shard_wait } );
+			}
+
+			const auto id = journal ? c_journal::archive_id( rez ) : 0u;
+
+			if ( journal )
+				log( " - Resume: {:d} resources already extracted\n", journal->count( id ) );
+
+			c_rez_file::filter_t filter{};
+			c_rez_file::done_t   done{};
+
+			if ( plan || journal )
+			{
+				filter = [&] ( const std::size_t dir, const std::size_t res )
+				{
+					if ( plan && plan->m_shard[ dir ][ res ] != g_shard_index )
+						return false;
+
+					if ( !journal || !journal->done( id, dir, res ) )
+						return true;
+
+					//
+					// recorded, extracted again if the file went missing since
+					//
+					const auto& resource = rez.index().m_directories[ dir ].m_resource[ res ];
+
+					std::error_code ec{};
+
+					const auto file = save_path / rez.directory_path( dir ) / c_rez_file::resource_filename( resource );
+
+					return std::filesystem::file_size( file, ec ) != resource.m_header.m_size || ec;
+				};
+			}
+
+			if ( journal )
+			{
+				done = [&] ( const std::size_t dir, const std::size_t res )
+				{
+					journal->complete( id, dir, res );
+				};
+			}
 
 			// extract to save path
-			rez.extract( save_path );
+			if ( const auto failed_resources = rez.extract( save_path, filter, done ) )
+			{
+				log( " - Failed: {:d} resources\n", failed_resources );
+
+				++failed;
+			}
 		}
 		catch ( const std::exception& e )
 		{
 			log( "[FATAL] {:s}\n", e.what() );
 			pause();
+
+			++failed;
 		}
 	}
+
+	return failed;
 }
\ No newline at end of file
@@ -0,0 +1,425 @@
+#include "pch.hpp"
+#include "salvage.hpp"
+
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+
+namespace rez
+{
+
+//
+// file range scanned by a single task
+//
+static constexpr std::uint64_t SALVAGE_RANGE_SIZE = 0x1000000u; // 16M
+
+//
+// limits of a plausible entry
+//
+static constexpr std::size_t   SALVAGE_MAX_NAME = 0xFFu;
+static constexpr std::size_t   SALVAGE_MAX_DESC = 0x400u;
+static constexpr std::uint32_t SALVAGE_MAX_KEYS = 0x100u;
+
+struct salvage_candidate_t
+{
+	std::uint64_t  m_offset{};
+	std::uint64_t  m_end{};
+	block_header_t m_header{};
+};
+
+/**
+ * @brief length of a NUL terminated name inside the file
+ */
+static auto name_length(
+	const char* data,
+	const std::uint64_t file_size,
+	const std::uint64_t offset,
+	const std::size_t max,
+	const bool description
+) -> std::optional< std::size_t >
+{
+	for ( std::size_t i = 0u; i <= max && offset + i < file_size; ++i )
+	{
+		const auto ch = static_cast< unsigned char >( data[ offset + i ] );
+
+		if ( ch == 0u )
+		{
+			if ( i == 0u && !description )
+				return std::nullopt;
+
+			return i;
+		}
+
+		if ( ch < 0x20u || ch == 0x7Fu )
+			return std::nullopt;
+
+		if ( !description && ( ch == '/' || ch == '\\' ) )
+			return std::nullopt;
+	}
+
+	return std::nullopt;
+}
+
+/**
+ * @brief full check of a single entry
+ */
+static auto validate( const char* data, const std::uint64_t file_size, const std::uint64_t offset ) -> std::optional< salvage_candidate_t >
+{
+	if ( offset + sizeof( block_header_t ) > file_size )
+		return std::nullopt;
+
+	salvage_candidate_t candidate{ offset, 0u, load_block_header( data + offset ) };
+
+	const auto& header = candidate.m_header;
+
+	if ( std::uint64_t{ header.m_pos } + header.m_size > file_size )
+		return std::nullopt;
+
+	switch ( header.m_type )
+	{
+	case file_directory_entry_type_directory:
+	{
+		const auto name = name_length( data, file_size, offset + entry_layout_t::DIR_NAME, SALVAGE_MAX_NAME, false );
+
+		if ( !name )
+			return std::nullopt;
+
+		// a block holds at least one entry
+		if ( header.m_size != 0u && header.m_size < sizeof( block_header_t ) + 2u )
+			return std::nullopt;
+
+		candidate.m_end = offset + entry_layout_t::DIR_NAME + *name + 1u;
+
+		return candidate;
+	}
+	case file_directory_entry_type_resource:
+	{
+		if ( offset + entry_layout_t::RES_NAME > file_size )
+			return std::nullopt;
+
+		//
+		// extension: alphanumeric characters followed by NUL padding
+		//
+		bool padding = false;
+
+		for ( std::size_t i = 0u; i < 4u; ++i )
+		{
+			const auto ch = static_cast< unsigned char >( data[ offset + entry_layout_t::RES_EXT + i ] );
+
+			if ( ch == 0u )
+				padding = true;
+			else if ( padding || !( std::isalnum( ch ) || ch == '_' ) )
+				return std::nullopt;
+		}
+
+		const auto num_keys = load_le< std::uint32_t >( data + offset + entry_layout_t::RES_KEYS );
+
+		if ( num_keys > SALVAGE_MAX_KEYS )
+			return std::nullopt;
+
+		const auto name = name_length( data, file_size, offset + entry_layout_t::RES_NAME, SALVAGE_MAX_NAME, false );
+
+		if ( !name )
+			return std::nullopt;
+
+		const auto description = name_length( data, file_size, offset + entry_layout_t::RES_NAME + *name + 1u, SALVAGE_MAX_DESC, true );
+
+		if ( !description )
+			return std::nullopt;
+
+		candidate.m_end = offset + entry_layout_t::RES_NAME + *name + 1u + *description + 1u + std::uint64_t{ num_keys } * sizeof( std::uint32_t );
+
+		if ( candidate.m_end > file_size )
+			return std::nullopt;
+
+		return candidate;
+	}
+	default:
+		return std::nullopt;
+	}
+}
+
+/**
+ * @brief scan [begin, end) for entries
+ *
+ * 16 offsets are tested per step with SSE2, an offset is only validated when
+ * - the type dword is 0 or 1 (low byte <= 1, the 3 bytes after it are zero)
+ * - the first name byte is not NUL (offset 16 for a directory, 28 for a resource)
+ */
+static auto scan_range( const c_mapped_file& file, const std::uint64_t begin, const std::uint64_t end ) -> std::vector< salvage_candidate_t >
+{
+	const auto data = file.data();
+	const auto size = file.size();
+
+	std::vector< salvage_candidate_t > candidates{};
+
+	auto offset = begin;
+
+	const auto zero = _mm_setzero_si128();
+	const auto one  = _mm_set1_epi8( 1 );
+
+	//
+	// the widest load ends at offset + 44
+	//
+	while ( offset < end && offset + 44u <= size )
+	{
+		const auto v0 = _mm_loadu_si128( reinterpret_cast< const __m128i* >( data + offset ) );
+		const auto v1 = _mm_loadu_si128( reinterpret_cast< const __m128i* >( data + offset + entry_layout_t::DIR_NAME ) );
+		const auto v2 = _mm_loadu_si128( reinterpret_cast< const __m128i* >( data + offset + entry_layout_t::RES_NAME ) );
+
+		const auto z0 = static_cast< std::uint32_t >( _mm_movemask_epi8( _mm_cmpeq_epi8( v0, zero ) ) );
+		const auto z1 = static_cast< std::uint32_t >( _mm_movemask_epi8( _mm_cmpeq_epi8( v1, zero ) ) );
+		const auto z2 = static_cast< std::uint32_t >( _mm_movemask_epi8( _mm_cmpeq_epi8( v2, zero ) ) );
+		const auto e1 = static_cast< std::uint32_t >( _mm_movemask_epi8( _mm_cmpeq_epi8( v0, one ) ) );
+
+		const auto z    = z0 | ( z1 << 16u );
+		const auto high = ( z >> 1u ) & ( z >> 2u ) & ( z >> 3u );
+
+		auto mask = ( ( e1 & ~z1 ) | ( z0 & ~z2 ) ) & high & 0xFFFFu;
+
+		if ( end - offset < 16u )
+			mask &= ( 1u << ( end - offset ) ) - 1u;
+
+		while ( mask )
+		{
+			const auto i = static_cast< std::uint64_t >( std::countr_zero( mask ) );
+
+			mask &= mask - 1u;
+
+			if ( const auto candidate = validate( data, size, offset + i ) )
+				candidates.emplace_back( *candidate );
+		}
+
+		offset += 16u;
+	}
+
+	//
+	// end of the file
+	//
+	for ( ; offset < end; ++offset )
+	{
+		if ( const auto candidate = validate( data, size, offset ) )
+			candidates.emplace_back( *candidate );
+	}
+
+	return candidates;
+}
+
+}
+
+auto rez::salvage_index( const c_mapped_file& file, c_thread_pool& pool, salvage_stats_t& stats ) -> rez_t
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	stats = {};
+
+	//
+	// parallel scan, the ranges are merged in file order
+	//
+	std::vector< std::future< std::vector< salvage_candidate_t > > > ranges{};
+
+	for ( std::uint64_t begin = 0u; begin < file.size(); begin += SALVAGE_RANGE_SIZE )
+	{
+		const auto end = std::min( begin + SALVAGE_RANGE_SIZE, file.size() );
+
+		ranges.emplace_back( pool.submit( [&file, begin, end] { return scan_range( file, begin, end ); } ) );
+	}
+
+	std::vector< salvage_candidate_t > candidates{};
+
+	for ( auto& range : ranges )
+	{
+		auto values = range.get();
+
+		candidates.insert( candidates.end(), values.begin(), values.end() );
+	}
+
+	stats.m_candidates = candidates.size();
+
+	static constexpr auto npos = std::numeric_limits< std::size_t >::max();
+
+	auto find = [&candidates] ( const std::uint64_t offset ) -> std::size_t
+	{
+		const auto it = std::lower_bound( candidates.begin(), candidates.end(), offset, [] ( const salvage_candidate_t& candidate, const std::uint64_t value )
+		{
+			return candidate.m_offset < value;
+		} );
+
+		return it != candidates.end() && it->m_offset == offset ? static_cast< std::size_t >( it - candidates.begin() ) : npos;
+	};
+
+	//
+	// entries of a block, as far as they chain up
+	//
+	auto walk = [&] ( const std::uint64_t pos, const std::uint64_t size ) -> std::vector< std::size_t >
+	{
+		std::vector< std::size_t > entries{};
+
+		for ( auto offset = pos; offset < pos + size; )
+		{
+			const auto index = find( offset );
+
+			if ( index == npos || candidates[ index ].m_end > pos + size )
+				break;
+
+			entries.emplace_back( index );
+
+			offset = candidates[ index ].m_end;
+		}
+
+		return entries;
+	};
+
+	//
+	// entries owned by a referenced block
+	//
+	std::vector< bool > owned( candidates.size(), false );
+
+	for ( const auto& candidate : candidates )
+	{
+		if ( candidate.m_header.m_type != file_directory_entry_type_directory || candidate.m_header.m_size == 0u )
+			continue;
+
+		for ( const auto index : walk( candidate.m_header.m_pos, candidate.m_header.m_size ) )
+			owned[ index ] = true;
+	}
+
+	//
+	// chains of entries nothing references
+	//
+	std::vector< std::vector< std::size_t > > roots{};
+	std::vector< std::vector< std::size_t > > orphans{};
+
+	std::vector< bool > chained( candidates.size(), false );
+
+	for ( std::size_t i = 0u; i < candidates.size(); ++i )
+	{
+		if ( owned[ i ] || chained[ i ] )
+			continue;
+
+		std::vector< std::size_t > chain{ i };
+
+		chained[ i ] = true;
+
+		for ( auto next = find( candidates[ i ].m_end ); next != npos && !owned[ next ] && !chained[ next ]; next = find( candidates[ next ].m_end ) )
+		{
+			chain.emplace_back( next );
+
+			chained[ next ] = true;
+		}
+
+		const bool root = std::any_of( chain.begin(), chain.end(), [&] ( const std::size_t index )
+		{
+			const auto& header = candidates[ index ].m_header;
+
+			return header.m_type == file_directory_entry_type_directory && header.m_size && !walk( header.m_pos, header.m_size ).empty();
+		} );
+
+		const auto resources = std::count_if( chain.begin(), chain.end(), [&] ( const std::size_t index )
+		{
+			return candidates[ index ].m_header.m_type == file_directory_entry_type_resource;
+		} );
+
+		if ( root )
+			roots.emplace_back( std::move( chain ) );
+		else if ( resources >= 2 )
+			orphans.emplace_back( std::move( chain ) );
+		else
+			stats.m_dropped += chain.size();
+	}
+
+	stats.m_roots = roots.size();
+
+	//
+	// rebuild the tree
+	//
+	rez_t rez{};
+
+	std::vector< block_resource_t >  loose{};
+	std::unordered_set< std::uint64_t > visited{};
+
+	auto make_resource = [&] ( const salvage_candidate_t& candidate ) -> block_resource_t
+	{
+		const auto view = file.view( candidate.m_offset, candidate.m_end - candidate.m_offset );
+
+		std::vector< char > entry( view.begin(), view.end() );
+
+		block_iterator_t itr = { entry.begin(), entry.end() };
+
+		itr.advance( static_cast< std::uint32_t >( sizeof( block_header_t ) ) );
+
+		auto res = block_resource_t{ candidate.m_header };
+
+		res.read_resource( itr );
+
+		return res;
+	};
+
+	std::function< void( const std::vector< std::size_t >&, const std::size_t ) > build = [&] ( const std::vector< std::size_t >& entries, const std::size_t owner )
+	{
+		for ( const auto index : entries )
+		{
+			const auto& candidate = candidates[ index ];
+
+			if ( candidate.m_header.m_type == file_directory_entry_type_resource )
+			{
+				if ( owner == npos )
+					loose.emplace_back( make_resource( candidate ) );
+				else
+					rez.m_directories[ owner ].m_resource.emplace_back( make_resource( candidate ) );
+
+				continue;
+			}
+
+			const auto dir_index = rez.m_directories.size();
+
+			auto& dir = rez.m_directories.emplace_back( directory_t{ candidate.m_header } );
+
+			dir.m_owner_index = owner;
+			dir.m_name        = std::string{ file.data() + candidate.m_offset + entry_layout_t::DIR_NAME };
+
+			if ( candidate.m_header.m_size && visited.emplace( candidate.m_header.m_pos ).second )
+			{
+				const auto children = walk( candidate.m_header.m_pos, candidate.m_header.m_size );
+
+				if ( !children.empty() )
+					++stats.m_blocks;
+
+				build( children, dir_index );
+			}
+		}
+	};
+
+	for ( const auto& root : roots )
+		build( root, npos );
+
+	for ( const auto& chain : orphans )
+	{
+		for ( const auto index : chain )
+		{
+			if ( candidates[ index ].m_header.m_type == file_directory_entry_type_resource )
+			{
+				loose.emplace_back( make_resource( candidates[ index ] ) );
+
+				++stats.m_orphans;
+			}
+		}
+	}
+
+	if ( !loose.empty() )
+	{
+		auto& dir = rez.m_directories.emplace_back();
+
+		dir.m_name        = "_salvaged";
+		dir.m_owner_index = npos;
+		dir.m_resource    = std::move( loose );
+	}
+
+	stats.m_directories = rez.m_directories.size();
+
+	for ( const auto& dir : rez.m_directories )
+		stats.m_resources += dir.m_resource.size();
+
+	stats.m_seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+
+	return rez;
+}
@@ -0,0 +1,279 @@
+#include "pch.hpp"
+#include "search.hpp"
+
+#include "mapped_file.hpp"
+#include "rez_file.hpp"
+#include "thread_pool.hpp"
+
+namespace rez
+{
+
+//
+// bytes per task, small resources are batched up to it and large ones split into it
+//
+static constexpr std::uint64_t SEARCH_SLICE = 4ull << 20u;
+
+struct search_item_t
+{
+	std::string   m_path{};
+	std::uint32_t m_pos{};
+	std::uint32_t m_size{};
+};
+
+/**
+ * @brief part of a resource scanned by a task
+ */
+struct search_part_t
+{
+	std::size_t   m_item{};
+	std::uint64_t m_begin{};
+	std::uint64_t m_end{};
+};
+
+struct search_archive_t
+{
+	std::filesystem::path                       m_path{};
+	std::unique_ptr< c_mapped_file >            m_file{};
+	std::vector< search_item_t >                m_items{};
+	std::vector< std::vector< search_part_t > > m_tasks{};
+
+	// read from when the archive couldn't be mapped (i.e no address space left), one task reads at a time
+	std::unique_ptr< c_rez_file >               m_rez{};
+	mutable std::mutex                          m_mutex{};
+};
+
+struct part_hit_t
+{
+	std::size_t   m_item{};
+	std::uint64_t m_offset{};
+	std::size_t   m_pattern{};
+};
+
+static auto open_archive( const std::filesystem::path& path, const search_options_t& options ) -> std::unique_ptr< search_archive_t >
+{
+	auto rez = std::make_unique< c_rez_file >( path );
+
+	rez->load();
+	rez->read_index();
+
+	auto archive = std::make_unique< search_archive_t >();
+
+	archive->m_path = path;
+
+	try
+	{
+		archive->m_file = std::make_unique< c_mapped_file >( path );
+	}
+	catch ( const std::exception& e )
+	{
+		log( "{:s}\n - Reading {:s} instead of mapping it\n", e.what(), path.string() );
+	}
+
+	const auto& directories = rez->index().m_directories;
+
+	for ( std::size_t d = 0u; d < directories.size(); ++d )
+	{
+		const auto dir_path = rez->directory_path( d );
+
+		for ( const auto& res : directories[ d ].m_resource )
+		{
+			if ( !options.m_types.empty() && std::find( options.m_types.begin(), options.m_types.end(), to_lower( res.m_type ) ) == options.m_types.end() )
+				continue;
+
+			archive->m_items.emplace_back( search_item_t{
+				( dir_path / c_rez_file::resource_filename( res ) ).generic_string(),
+				res.m_header.m_pos,
+				res.m_header.m_size
+			} );
+		}
+	}
+
+	//
+	// offset order, the tasks read the archive front to back
+	//
+	std::stable_sort( archive->m_items.begin(), archive->m_items.end(), [] ( const search_item_t& lhs, const search_item_t& rhs )
+	{
+		return lhs.m_pos < rhs.m_pos;
+	} );
+
+	std::vector< search_part_t > task{};
+	std::uint64_t                task_size = 0u;
+
+	for ( std::size_t i = 0u; i < archive->m_items.size(); ++i )
+	{
+		const std::uint64_t size = archive->m_items[ i ].m_size;
+
+		for ( std::uint64_t begin = 0u; begin < size; begin += SEARCH_SLICE )
+		{
+			const auto end = std::min( size, begin + SEARCH_SLICE );
+
+			task.emplace_back( search_part_t{ i, begin, end } );
+
+			task_size += end - begin;
+
+			if ( task_size >= SEARCH_SLICE )
+			{
+				archive->m_tasks.emplace_back( std::move( task ) );
+
+				task.clear();
+				task_size = 0u;
+			}
+		}
+	}
+
+	if ( !task.empty() )
+		archive->m_tasks.emplace_back( std::move( task ) );
+
+	if ( !archive->m_file )
+		archive->m_rez = std::move( rez );
+
+	return archive;
+}
+
+static auto scan_parts(
+	const search_archive_t& archive,
+	const std::vector< search_part_t >& parts,
+	const c_matcher& matcher
+) -> std::vector< part_hit_t >
+{
+	std::vector< part_hit_t > hits{};
+
+	std::vector< char > buffer{};
+
+	for ( const auto& part : parts )
+	{
+		const auto& item = archive.m_items[ part.m_item ];
+
+		// a match may start in this part and end in the next one
+		const auto end = std::min< std::uint64_t >( item.m_size, part.m_end + matcher.longest() - 1u );
+
+		std::string_view view{};
+
+		if ( archive.m_file )
+		{
+			view = archive.m_file->view( item.m_pos + part.m_begin, end - part.m_begin );
+
+			//
+			// one large read instead of a page fault per 4K, best effort (Windows 8+)
+			//
+			WIN32_MEMORY_RANGE_ENTRY range{ const_cast< char* >( view.data() ), view.size() };
+
+			::PrefetchVirtualMemory( ::GetCurrentProcess(), 1u, &range, 0u );
+		}
+		else
+		{
+			buffer.resize( static_cast< std::size_t >( end - part.m_begin ) );
+
+			{
+				std::scoped_lock lock{ archive.m_mutex };
+
+				archive.m_rez->read_at( item.m_pos + static_cast< std::uint32_t >( part.m_begin ), buffer.data(), static_cast< std::uint32_t >( buffer.size() ) );
+			}
+
+			view = { buffer.data(), buffer.size() };
+		}
+
+		matcher.scan( view.data(), view.size(), static_cast< std::size_t >( part.m_end - part.m_begin ), [&] ( const std::size_t offset, const std::size_t pattern )
+		{
+			hits.emplace_back( part_hit_t{ part.m_item, part.m_begin + offset, pattern } );
+		} );
+	}
+
+	// the patterns are scanned one after the other
+	std::sort( hits.begin(), hits.end(), [] ( const part_hit_t& lhs, const part_hit_t& rhs )
+	{
+		return std::tie( lhs.m_item, lhs.m_offset, lhs.m_pattern ) < std::tie( rhs.m_item, rhs.m_offset, rhs.m_pattern );
+	} );
+
+	return hits;
+}
+
+}
+
+auto rez::search_archives(
+	const std::vector< std::filesystem::path >& file_path,
+	const search_options_t& options,
+	const std::function< void( const search_hit_t& ) >& on_hit
+) -> search_stats_t
+{
+	const c_matcher matcher{ options.m_patterns, options.m_ignore_case };
+
+	c_thread_pool pool{ options.m_threads };
+
+	search_stats_t stats{};
+
+	const auto start = std::chrono::steady_clock::now();
+
+	auto open = [&] ( const std::size_t index ) -> std::unique_ptr< search_archive_t >
+	{
+		if ( index >= file_path.size() )
+			return nullptr;
+
+		try
+		{
+			return open_archive( file_path[ index ], options );
+		}
+		catch ( const std::exception& e )
+		{
+			log( "[FATAL] {:s}: {:s}\n", file_path[ index ].string(), e.what() );
+
+			return nullptr;
+		}
+	};
+
+	auto next = open( 0u );
+
+	for ( std::size_t a = 0u; a < file_path.size(); ++a )
+	{
+		const auto archive = std::move( next );
+
+		if ( !archive )
+		{
+			next = open( a + 1u );
+
+			continue;
+		}
+
+		std::vector< std::future< std::vector< part_hit_t > > > pending{};
+
+		for ( const auto& task : archive->m_tasks )
+		{
+			pending.emplace_back( pool.submit( [&archive = *archive, &task, &matcher]
+			{
+				return scan_parts( archive, task, matcher );
+			} ) );
+		}
+
+		//
+		// index the next archive while the workers scan this one
+		//
+		next = open( a + 1u );
+
+		for ( auto& future : pending )
+		{
+			try
+			{
+				for ( const auto& hit : future.get() )
+				{
+					on_hit( search_hit_t{ archive->m_path, archive->m_items[ hit.m_item ].m_path, hit.m_offset, hit.m_pattern } );
+
+					++stats.m_hits;
+				}
+			}
+			catch ( const std::exception& e )
+			{
+				log( "[ERROR] {:s}: {:s}\n", archive->m_path.string(), e.what() );
+			}
+		}
+
+		stats.m_archives  += 1u;
+		stats.m_resources += archive->m_items.size();
+
+		for ( const auto& item : archive->m_items )
+			stats.m_bytes += item.m_size;
+	}
+
+	stats.m_seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+
+	return stats;
+}
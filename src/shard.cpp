@@ -0,0 +1,181 @@
+#include "pch.hpp"
+#include "shard.hpp"
+
+#include "rez_file.hpp"
+
+namespace rez
+{
+
+static constexpr auto SHARD_POLL = std::chrono::milliseconds{ 250 };
+
+static auto marker_path( const c_rez_file& rez, const std::filesystem::path& output ) -> std::filesystem::path
+{
+	return output / std::format( ".{:s}.shards", rez.path().filename().string() );
+}
+
+/**
+ * @brief identifies the archive the skeleton was made for
+ */
+static auto marker_content( const c_rez_file& rez ) -> std::string
+{
+	return std::format( "{:016X}\n", rez.fingerprint() );
+}
+
+static auto read_marker( const std::filesystem::path& path ) -> std::string
+{
+	std::ifstream in{ path, std::ios::binary };
+
+	if ( !in )
+		return {};
+
+	return { std::istreambuf_iterator< char >{ in }, std::istreambuf_iterator< char >{} };
+}
+
+}
+
+void rez::parse_shard( const std::string_view value, std::uint32_t& index, std::uint32_t& count )
+{
+	const auto slash = value.find( '/' );
+
+	auto parse = [value] ( const std::string_view part ) -> std::uint32_t
+	{
+		std::uint32_t result = 0u;
+
+		const auto [ptr, ec] = std::from_chars( part.data(), part.data() + part.size(), result );
+
+		if ( ec != std::errc{} || ptr != part.data() + part.size() )
+			REZ_THROW( "Invalid value for --shard: {:s} (Expected: i/N)", value );
+
+		return result;
+	};
+
+	if ( slash == std::string_view::npos )
+		REZ_THROW( "Invalid value for --shard: {:s} (Expected: i/N)", value );
+
+	index = parse( value.substr( 0u, slash ) );
+	count = parse( value.substr( slash + 1u ) );
+
+	if ( count == 0u || index >= count )
+		REZ_THROW( "Invalid value for --shard: {:s} (Expected: 0 <= i < N)", value );
+}
+
+auto rez::plan_shards( const rez_t& index, const std::uint32_t count ) -> shard_plan_t
+{
+	if ( count == 0u )
+		REZ_THROW( " - Invalid shard count: 0" );
+
+	const auto& directories = index.m_directories;
+
+	struct item_t
+	{
+		std::uint32_t m_pos;
+		std::uint32_t m_size;
+		std::size_t   m_dir;
+		std::size_t   m_res;
+	};
+
+	std::vector< item_t > items{};
+
+	std::uint64_t total = 0u;
+
+	shard_plan_t plan{};
+
+	plan.m_shard.resize( directories.size() );
+	plan.m_ranges.resize( count );
+
+	for ( std::size_t d = 0u; d < directories.size(); ++d )
+	{
+		plan.m_shard[ d ].resize( directories[ d ].m_resource.size() );
+
+		for ( std::size_t r = 0u; r < directories[ d ].m_resource.size(); ++r )
+		{
+			const auto& header = directories[ d ].m_resource[ r ].m_header;
+
+			items.emplace_back( item_t{ header.m_pos, header.m_size, d, r } );
+
+			total += header.m_size;
+		}
+	}
+
+	//
+	// offset order, a shard reads a single region of the archive
+	//
+	std::sort( items.begin(), items.end(), [] ( const item_t& lhs, const item_t& rhs )
+	{
+		return std::tie( lhs.m_pos, lhs.m_size, lhs.m_dir, lhs.m_res ) < std::tie( rhs.m_pos, rhs.m_size, rhs.m_dir, rhs.m_res );
+	} );
+
+	//
+	// a resource goes to the shard its middle byte falls in, the shard never decreases along
+	// the offsets so the ranges stay contiguous (by count when every resource is empty)
+	//
+	std::uint64_t prefix = 0u;
+
+	for ( std::size_t i = 0u; i < items.size(); ++i )
+	{
+		const auto& item = items[ i ];
+
+		const auto shard = static_cast< std::uint32_t >( std::min< std::uint64_t >(
+			total ?
+				( ( prefix * 2u + item.m_size ) * count ) / ( total * 2u ) :
+				( i * static_cast< std::uint64_t >( count ) ) / items.size(),
+			count - 1u
+		) );
+
+		plan.m_shard[ item.m_dir ][ item.m_res ] = shard;
+
+		auto& range = plan.m_ranges[ shard ];
+
+		if ( range.m_resources++ == 0u )
+			range.m_begin = item.m_pos;
+
+		range.m_end    = std::max( range.m_end, item.m_pos + static_cast< std::uint64_t >( item.m_size ) );
+		range.m_bytes += item.m_size;
+
+		prefix += item.m_size;
+	}
+
+	return plan;
+}
+
+void rez::prepare_shard( const c_rez_file& rez, const std::filesystem::path& output, const std::uint32_t index, const std::chrono::seconds wait )
+{
+	const auto marker  = marker_path( rez, output );
+	const auto content = marker_content( rez );
+
+	if ( index == 0u )
+	{
+		rez.create_directories( output );
+
+		//
+		// written aside and renamed, a waiting shard never reads half a marker
+		//
+		auto temp = marker;
+
+		temp += ".tmp";
+
+		{
+			std::ofstream out{};
+			out.exceptions( std::ios::badbit | std::ios::failbit );
+			out.open( temp, std::ios::binary );
+			out.write( content.data(), static_cast< std::streamsize >( content.size() ) );
+		}
+
+		std::filesystem::rename( temp, marker );
+
+		return;
+	}
+
+	const auto deadline = std::chrono::steady_clock::now() + wait;
+
+	for ( bool logged = false; read_marker( marker ) != content; logged = true )
+	{
+		if ( std::chrono::steady_clock::now() >= deadline )
+			REZ_THROW( " - Timed out waiting for shard 0 to create the directories after {:d}s ({:s}), see --shard-wait", wait.count(), marker.string() );
+
+		if ( !logged )
+			log( " - Waiting up to {:d}s for shard 0 to create the directories\n", wait.count() );
+
+		std::this_thread::sleep_for( SHARD_POLL );
+	}
+}
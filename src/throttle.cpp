@@ -0,0 +1,235 @@
+#include "pch.hpp"
+#include "throttle.hpp"
+
+#include "arguments.hpp"
+
+namespace rez
+{
+
+//
+// a bucket holds at most this much of its rate, an idle stretch doesn't turn into a burst
+//
+static constexpr double BURST_SECONDS = 0.1;
+
+static constexpr std::int64_t POLL_INTERVAL = 1'000'000'000;
+
+static auto steady_ns() -> std::int64_t
+{
+	return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+/**
+ * @brief "max-read SIZE" / "max-write SIZE" / "max-creates N" lines, the missing ones keep their value
+ */
+static auto read_control_file( const std::filesystem::path& path, throttle_limits_t limits ) -> throttle_limits_t
+{
+	std::ifstream in{ path };
+
+	if ( !in )
+		REZ_THROW( " - Can't open throttle file: {:s}", path.string() );
+
+	for ( std::string line{}; std::getline( in, line ); )
+	{
+		const std::string_view text{ line };
+
+		const auto key_begin   = text.find_first_not_of( " \t" );
+		const auto key_end     = text.find_first_of( " \t", key_begin );
+		const auto value_begin = text.find_first_not_of( " \t", key_end );
+		const auto value_end   = text.find_last_not_of( " \t\r" );
+
+		// blank line or comment
+		if ( key_begin == std::string_view::npos || text[ key_begin ] == '#' )
+			continue;
+
+		if ( value_begin == std::string_view::npos )
+			REZ_THROW( " - Missing value in throttle file: {:s}", line );
+
+		const auto key   = text.substr( key_begin, key_end - key_begin );
+		const auto value = text.substr( value_begin, value_end - value_begin + 1u );
+
+		if ( key == "max-read" )
+			limits.m_read = c_arguments::parse< std::uint64_t >( key, value );
+		else if ( key == "max-write" )
+			limits.m_write = c_arguments::parse< std::uint64_t >( key, value );
+		else if ( key == "max-creates" )
+			limits.m_creates = c_arguments::parse< std::uint64_t >( key, value );
+		else
+			REZ_THROW( " - Unknown throttle setting: {:s}", key );
+	}
+
+	return limits;
+}
+
+}
+
+void rez::c_token_bucket::set_rate( const std::uint64_t rate )
+{
+	std::scoped_lock lock{ m_mutex };
+
+	this->refill( clock_t::now() );
+
+	m_rate   = rate;
+	m_tokens = std::min( m_tokens, static_cast< double >( rate ) * BURST_SECONDS );
+}
+
+auto rez::c_token_bucket::rate() const -> std::uint64_t
+{
+	std::scoped_lock lock{ m_mutex };
+
+	return m_rate;
+}
+
+void rez::c_token_bucket::acquire( const std::uint64_t amount )
+{
+	std::chrono::nanoseconds wait{};
+
+	{
+		std::scoped_lock lock{ m_mutex };
+
+		if ( m_rate == 0u )
+			return;
+
+		this->refill( clock_t::now() );
+
+		m_tokens -= static_cast< double >( amount );
+
+		if ( m_tokens < 0.0 )
+			wait = std::chrono::nanoseconds{ static_cast< std::int64_t >( -m_tokens / static_cast< double >( m_rate ) * 1e9 ) };
+	}
+
+	if ( wait.count() <= 0 )
+		return;
+
+	std::this_thread::sleep_for( wait );
+
+	m_throttled.fetch_add( static_cast< std::uint64_t >( wait.count() ), std::memory_order_relaxed );
+}
+
+void rez::c_token_bucket::refill( const clock_t::time_point now )
+{
+	const auto elapsed = std::chrono::duration< double >( now - m_last ).count();
+
+	m_last = now;
+
+	// at least one operation, a rate below 10/s still lets one through
+	const auto burst = std::max( static_cast< double >( m_rate ) * BURST_SECONDS, 1.0 );
+
+	m_tokens = std::min( m_tokens + elapsed * static_cast< double >( m_rate ), burst );
+}
+
+void rez::c_throttle::set_limits( const throttle_limits_t& limits )
+{
+	m_read.set_rate( limits.m_read );
+	m_write.set_rate( limits.m_write );
+	m_create.set_rate( limits.m_creates );
+}
+
+auto rez::c_throttle::limits() const -> throttle_limits_t
+{
+	return { m_read.rate(), m_write.rate(), m_create.rate() };
+}
+
+void rez::c_throttle::set_control_file( const std::filesystem::path& path )
+{
+	{
+		std::scoped_lock lock{ m_control_mutex };
+
+		m_control      = path;
+		m_control_time = {};
+	}
+
+	m_next_poll = 0;
+
+	this->poll();
+}
+
+void rez::c_throttle::read( const std::uint64_t bytes )
+{
+	this->poll();
+
+	if ( !m_suspended )
+		m_read.acquire( bytes );
+}
+
+void rez::c_throttle::write( const std::uint64_t bytes )
+{
+	this->poll();
+
+	if ( !m_suspended )
+		m_write.acquire( bytes );
+}
+
+void rez::c_throttle::create()
+{
+	this->poll();
+
+	if ( !m_suspended )
+		m_create.acquire( 1u );
+}
+
+auto rez::c_throttle::toggle() -> bool
+{
+	auto suspended = m_suspended.load();
+
+	while ( !m_suspended.compare_exchange_weak( suspended, !suspended ) )
+		;
+
+	return !suspended;
+}
+
+auto rez::c_throttle::active() const -> bool
+{
+	const auto current = this->limits();
+
+	if ( current.m_read || current.m_write || current.m_creates )
+		return true;
+
+	std::scoped_lock lock{ m_control_mutex };
+
+	return !m_control.empty();
+}
+
+auto rez::c_throttle::stats() const -> throttle_stats_t
+{
+	return { m_read.throttled_seconds(), m_write.throttled_seconds(), m_create.throttled_seconds() };
+}
+
+void rez::c_throttle::poll()
+{
+	//
+	// a single thread looks at the control file once per interval, the others don't wait for it
+	//
+	const auto now  = steady_ns();
+	auto       next = m_next_poll.load( std::memory_order_relaxed );
+
+	if ( now < next || !m_next_poll.compare_exchange_strong( next, now + POLL_INTERVAL ) )
+		return;
+
+	std::scoped_lock lock{ m_control_mutex };
+
+	if ( m_control.empty() )
+		return;
+
+	std::error_code ec{};
+
+	const auto time = std::filesystem::last_write_time( m_control, ec );
+
+	if ( ec || time == m_control_time )
+		return;
+
+	m_control_time = time;
+
+	try
+	{
+		const auto limits = read_control_file( m_control, this->limits() );
+
+		this->set_limits( limits );
+
+		log( " - Throttle: read {:d}/s, write {:d}/s, creates {:d}/s (0 is unlimited)\n", limits.m_read, limits.m_write, limits.m_creates );
+	}
+	catch ( const std::exception& e )
+	{
+		// a half written control file is read again on its next change
+		log( "[ERROR] {:s}\n", e.what() );
+	}
+}